@@ -0,0 +1,33 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc-counter.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of alloc-counter.hpp
+ */
+
+namespace {
+
+std::atomic<std::size_t> allocations(0);
+
+}
+
+std::size_t allocation_count() noexcept {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
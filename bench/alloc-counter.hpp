@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * ABSTRACT:
+ * Counts calls of the global operator new, so benchmarks can report the
+ * number of allocations of a workload. Linking alloc-counter.cpp replaces
+ * the global operator new and delete of the executable.
+ */
+
+/** @return number of allocations since the start of the program */
+std::size_t allocation_count() noexcept;
@@ -0,0 +1,143 @@
+#include <sstream>
+#include <string>
+#include "benchmark/benchmark.h"
+#include "alloc-counter.hpp"
+#include "generators.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/script-loader.hpp"
+
+/**
+ * ABSTRACT:
+ * Benchmarks for loading scripts: tokenizing (MB/s) and parsing
+ * (statements/s) of synthetic libraries, see generators.hpp. The arguments
+ * of every benchmark are
+ *   statements, depth, comment percentage, literal size
+ * and every benchmark reports bytes/s, statements/s and allocations per
+ * statement.
+ */
+
+namespace {
+
+LibraryShape shape(const benchmark::State& state) {
+    LibraryShape s;
+    s.statements = state.range(0);
+    s.depth = state.range(1);
+    s.comment_percent = state.range(2);
+    s.literal = state.range(3);
+    return s;
+}
+
+void set_counters(benchmark::State& state, const std::string& source,
+                  std::size_t allocs) {
+    auto statements = state.range(0) * state.iterations();
+    state.SetBytesProcessed(source.size() * state.iterations());
+    state.counters["statements/s"] = benchmark::Counter(
+        statements, benchmark::Counter::kIsRate);
+    state.counters["allocs/statement"] = benchmark::Counter(
+        static_cast<double>(allocs) / statements);
+}
+
+void shapes(benchmark::internal::Benchmark* b) {
+    /**
+     * library size, nesting depth, comment density and literal size,
+     * each varied on its own
+     */
+    b->ArgNames({"statements", "depth", "comments", "literal"});
+    for(long statements: {100, 1000, 5000})
+        b->Args({statements, 8, 0, 0});
+    for(long depth: {2, 32, 128})
+        b->Args({1000, depth, 0, 0});
+    for(long comments: {50, 100})
+        b->Args({1000, 8, comments, 0});
+    for(long literal: {10, 100, 1000})
+        b->Args({1000, 8, 0, literal});
+}
+
+template <typename TokenizerClass>
+std::size_t count_tokens(TokenizerClass& tz) {
+    std::size_t tokens = 0;
+    while(auto token = tz.get()) {
+        benchmark::DoNotOptimize(token);
+        ++tokens;
+    }
+    return tokens;
+}
+
+}
+
+static void BM_tokenizer(benchmark::State& state) {
+    auto source = synthetic_library(shape(state));
+    std::size_t allocs = allocation_count();
+    for(auto _: state) {
+        std::istringstream is(source);
+        Tokenizer<Symbol> tz(is);
+        benchmark::DoNotOptimize(count_tokens(tz));
+    }
+    set_counters(state, source, allocation_count() - allocs);
+}
+BENCHMARK(BM_tokenizer)->Apply(shapes);
+
+static void BM_buffer_tokenizer(benchmark::State& state) {
+    auto source = synthetic_library(shape(state));
+    std::size_t allocs = allocation_count();
+    for(auto _: state) {
+        BufferTokenizer<Symbol> tz(source);
+        benchmark::DoNotOptimize(count_tokens(tz));
+    }
+    set_counters(state, source, allocation_count() - allocs);
+}
+BENCHMARK(BM_buffer_tokenizer)->Apply(shapes);
+
+static void BM_buffer_tokenizer_generated(benchmark::State& state) {
+    /**
+     * machine-generated input: long names and a lot of whitespace, the
+     * arguments are name length and padding
+     */
+    LibraryShape s;
+    s.statements = 1000;
+    s.name_length = state.range(0);
+    s.padding = state.range(1);
+    auto source = synthetic_library(s);
+    for(auto _: state) {
+        BufferTokenizer<Symbol> tz(source);
+        benchmark::DoNotOptimize(count_tokens(tz));
+    }
+    state.SetBytesProcessed(source.size() * state.iterations());
+}
+BENCHMARK(BM_buffer_tokenizer_generated)
+    ->ArgNames({"name_length", "padding"})
+    ->Args({1, 0})->Args({32, 0})->Args({1, 32})->Args({32, 32});
+
+static void BM_parser(benchmark::State& state) {
+    auto source = synthetic_library(shape(state));
+    std::size_t allocs = allocation_count();
+    for(auto _: state) {
+        std::istringstream is(source);
+        Parser parser(is);
+        for(long i = 0; i < state.range(0); ++i) parser.statement();
+    }
+    set_counters(state, source, allocation_count() - allocs);
+}
+BENCHMARK(BM_parser)->Apply(shapes);
+
+static void BM_buffer_parser(benchmark::State& state) {
+    auto source = synthetic_library(shape(state));
+    std::size_t allocs = allocation_count();
+    for(auto _: state) {
+        BufferParser parser(source);
+        for(long i = 0; i < state.range(0); ++i) parser.statement();
+    }
+    set_counters(state, source, allocation_count() - allocs);
+}
+BENCHMARK(BM_buffer_parser)->Apply(shapes);
+
+static void BM_load_script(benchmark::State& state) {
+    auto source = synthetic_library(shape(state));
+    std::size_t allocs = allocation_count();
+    for(auto _: state) {
+        Program program;
+        load_script(program, source);
+    }
+    set_counters(state, source, allocation_count() - allocs);
+}
+BENCHMARK(BM_load_script)->Apply(shapes)->UseRealTime();
@@ -0,0 +1,68 @@
+#include <random>
+#include "generators.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of generators.hpp
+ */
+
+namespace {
+
+std::string definition_name(std::size_t i) {
+    // NAMEs may only contain letters, so definitions are numbered in base 26
+    std::string digits;
+    do {
+        digits += static_cast<char>('A' + i % 26);
+        i /= 26;
+    } while(i > 0);
+    return "D" + std::string(digits.rbegin(), digits.rend());
+}
+
+}
+
+std::string synthetic_library(const LibraryShape& shape) {
+    std::mt19937 rng(shape.seed);
+    auto chance = [&rng](unsigned percent) {
+        return std::uniform_int_distribution<unsigned>(0, 99)(rng) < percent;
+    };
+    const std::string gap(1 + shape.padding, ' ');
+    auto variable = [&shape](std::size_t i) {
+        return std::string(shape.name_length, static_cast<char>('a' + i));
+    };
+    std::string out;
+    for(std::size_t i = 0; i < shape.statements; ++i) {
+        if(chance(shape.comment_percent))
+            out += "# definition " + std::to_string(i) +
+                   ", separators like ; are ignored in comments\n";
+        out += "'" + definition_name(i) + "'" + gap + "=" + gap;
+        // alternates lambdas and applications: \a . (\b . (... ) leaf) leaf
+        std::string closing;
+        std::size_t lambdas = 0;
+        for(std::size_t d = 0; d < shape.depth; ++d) {
+            if(d % 2 == 0) {
+                out += "\\" + gap + variable(lambdas++ % 26) + gap + "." +
+                       gap;
+            }
+            else {
+                // the leaf of the application is added when it is closed
+                out += "(";
+                std::string leaf;
+                if(shape.literal && chance(50))
+                    leaf = std::to_string(shape.literal);
+                else if(i > 0 && chance(25))
+                    leaf = definition_name(
+                        std::uniform_int_distribution<std::size_t>(0, i - 1)(
+                            rng));
+                else
+                    leaf = variable(
+                        std::uniform_int_distribution<std::size_t>(
+                            0, (lambdas - 1) % 26)(rng));
+                closing = ")" + gap + leaf + closing;
+            }
+        }
+        out += lambdas ? variable(0) : std::string(shape.name_length, 'x');
+        out += closing;
+        out += ";\n";
+    }
+    return out;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/**
+ * ABSTRACT:
+ * Generators for synthetic scripts, used to measure the cost of loading
+ * libraries of definitions. The shape of a script is controlled by
+ * LibraryShape: number of statements, nesting depth of every definition,
+ * density of comments, size of Church literals (which are encoded while
+ * parsing), length of variable names and amount of whitespace.
+ */
+
+struct LibraryShape {
+    /** number of definitions */
+    std::size_t statements = 100;
+    /** number of nested lambdas and applications of every definition */
+    std::size_t depth = 8;
+    /** percentage of definitions that are preceded by a comment line */
+    unsigned comment_percent = 0;
+    /** value of the Church literals in the definitions, 0 for none */
+    unsigned literal = 0;
+    /** characters of every variable name */
+    unsigned name_length = 1;
+    /** spaces between two tokens in addition to the single one */
+    unsigned padding = 0;
+    /** seed of the random generator, equal shapes give equal scripts */
+    unsigned seed = 1;
+};
+
+/**
+ * @return script of shape.statements definitions 'DA', 'DB', ..., each of
+ * which may refer to the definitions before it
+ */
+std::string synthetic_library(const LibraryShape& shape);
@@ -0,0 +1,205 @@
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "alloc-counter.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/script-loader.hpp"
+
+/**
+ * ABSTRACT:
+ * Benchmarks for beta reduction on typical workloads: arithmetic on Church
+ * numerals, recursion via the Y combinator, deep left-nested spines and
+ * random terms. Every iteration reduces the same terms until they reach
+ * their normal form (or a step limit) and every benchmark reports
+ *   steps       reduction steps per iteration
+ *   steps/s     reduction steps per second
+ *   allocs      allocations per iteration, not counting pooled nodes
+ *   node_bytes  node memory allocated per iteration (see node-allocator.hpp)
+ *   peak_nodes  maximum number of distinct nodes of an intermediate term
+ * Results can be written as JSON with --benchmark_format=json or
+ * --benchmark_out=FILE --benchmark_out_format=json.
+ */
+
+namespace {
+
+const unsigned long step_limit = 1000000;
+
+const Program& prelude() {
+    /**
+     * definitions of prelude/prelude.lambda, loaded once
+     */
+    static const Program program = [] {
+        Program p;
+        load_script_file(p, LAMBDA_PRELUDE);
+        return p;
+    }();
+    return program;
+}
+
+Expression_ptr parse(const std::string& input) {
+    /**
+     * @return unreduced expression of input, which may use the prelude
+     */
+    BufferParser parser(input);
+    parser.program = prelude();
+    return parser.statement().last_command().ex;
+}
+
+unsigned long normalize(Expression_ptr ex, unsigned long limit) {
+    /**
+     * @return number of steps until ex is in normal form, at most limit.
+     * Reduces in place like BetaReduction, the first step copies
+     */
+    unsigned long steps = 0;
+    NoStats stats;
+    for(; steps < limit; ++steps)
+        if(!reduce_in_place(ex, stats)) break;
+    return steps;
+}
+
+std::size_t count_nodes(const Expression_ptr& ex) {
+    /**
+     * @return number of distinct nodes reachable from ex
+     */
+    std::unordered_set<const Expression*> seen{ex.get()};
+    std::vector<const Expression*> stack{ex.get()};
+    auto visit = [&](const Expression* child) {
+        if(seen.insert(child).second) stack.push_back(child);
+    };
+    while(!stack.empty()) {
+        const Expression* e = stack.back();
+        stack.pop_back();
+        if(auto lbd = node_cast<Lambda>(e); lbd) {
+            visit(lbd->get_head().get());
+            visit(lbd->get_body().get());
+        }
+        else if(auto app = node_cast<Application>(e); app) {
+            visit(app->get_function().get());
+            visit(app->get_argument().get());
+        }
+    }
+    return seen.size();
+}
+
+std::size_t peak_nodes(Expression_ptr ex, unsigned long limit) {
+    /**
+     * @return maximum of count_nodes over all steps of normalize
+     */
+    std::size_t peak = count_nodes(ex);
+    for(unsigned long steps = 0; steps < limit; ++steps) {
+        auto next = ex->beta_reduce();
+        if(next == ex) break;
+        ex = next;
+        peak = std::max(peak, count_nodes(ex));
+    }
+    return peak;
+}
+
+void run(benchmark::State& state, const std::vector<Expression_ptr>& terms,
+         unsigned long limit = step_limit) {
+    /**
+     * normalizes terms in every iteration and sets the counters
+     */
+    std::size_t peak = 0;
+    for(const auto& term: terms)
+        peak = std::max(peak, peak_nodes(term, limit));
+    unsigned long steps = 0;
+    std::size_t allocs = allocation_count();
+    std::size_t node_bytes = node_memory().bytes_allocated;
+    for(auto _: state) {
+        steps = 0;
+        for(const auto& term: terms) steps += normalize(term, limit);
+    }
+    allocs = allocation_count() - allocs;
+    node_bytes = node_memory().bytes_allocated - node_bytes;
+    state.counters["steps"] = steps;
+    state.counters["steps/s"] = benchmark::Counter(
+        static_cast<double>(steps) * state.iterations(),
+        benchmark::Counter::kIsRate);
+    state.counters["allocs"] = benchmark::Counter(
+        allocs, benchmark::Counter::kAvgIterations);
+    state.counters["node_bytes"] = benchmark::Counter(
+        node_bytes, benchmark::Counter::kAvgIterations);
+    state.counters["peak_nodes"] = peak;
+}
+
+Expression_ptr random_term(std::mt19937& rng, std::size_t size,
+                           std::vector<Variable_ptr>& scope) {
+    /**
+     * @return random term with size nodes whose free variables are all in
+     * scope, i.e. a closed term if scope is empty
+     */
+    auto uniform = [&rng](std::size_t lo, std::size_t hi) {
+        return std::uniform_int_distribution<std::size_t>(lo, hi)(rng);
+    };
+    if(size <= 1 && !scope.empty())
+        return scope[uniform(0, scope.size() - 1)];
+    if(size <= 2 || scope.empty() || uniform(0, 2) == 0) {
+        std::string name(1, static_cast<char>('a' + scope.size() % 26));
+        auto head = make_node<Variable>(name, true);
+        scope.push_back(head);
+        auto body = random_term(rng, size - 1, scope);
+        scope.pop_back();
+        return make_node<Lambda>(head, body);
+    }
+    std::size_t left = uniform(1, size - 2);
+    auto function = random_term(rng, left, scope);
+    auto argument = random_term(rng, size - 1 - left, scope);
+    return make_node<Application>(function, argument);
+}
+
+}
+
+static void BM_church_add(benchmark::State& state) {
+    auto n = std::to_string(state.range(0));
+    run(state, {parse("((PLUS) " + n + ") " + n + ";")});
+}
+BENCHMARK(BM_church_add)->RangeMultiplier(4)->Range(8, 512);
+
+static void BM_church_mul(benchmark::State& state) {
+    auto n = std::to_string(state.range(0));
+    run(state, {parse("((MULT) " + n + ") " + n + ";")});
+}
+BENCHMARK(BM_church_mul)->RangeMultiplier(2)->Range(4, 64);
+
+static void BM_church_exp(benchmark::State& state) {
+    auto n = std::to_string(state.range(0));
+    run(state, {parse("((POW) 2) " + n + ";")});
+}
+BENCHMARK(BM_church_exp)->DenseRange(2, 10, 2);
+
+static void BM_factorial(benchmark::State& state) {
+    run(state, {parse("(FACT) " + std::to_string(state.range(0)) + ";")});
+}
+BENCHMARK(BM_factorial)->DenseRange(1, 4);
+
+static void BM_fibonacci(benchmark::State& state) {
+    run(state, {parse("(FIB) " + std::to_string(state.range(0)) + ";")});
+}
+BENCHMARK(BM_fibonacci)->DenseRange(2, 6, 2);
+
+static void BM_left_spine(benchmark::State& state) {
+    // (((I) I) ... ) I with I = \x . x, every step walks down the spine
+    auto identity = [] {
+        auto x = make_node<Variable>("x", true);
+        return make_node<Lambda>(x, x);
+    };
+    Expression_ptr spine = identity();
+    for(long i = 0; i < state.range(0); ++i)
+        spine = make_node<Application>(spine, identity());
+    run(state, {spine});
+}
+BENCHMARK(BM_left_spine)->RangeMultiplier(4)->Range(64, 1024);
+
+static void BM_random_terms(benchmark::State& state) {
+    // fixed seed, so every run reduces the same terms
+    std::mt19937 rng(42);
+    std::vector<Expression_ptr> terms;
+    std::vector<Variable_ptr> scope;
+    for(int i = 0; i < 16; ++i)
+        terms.push_back(random_term(rng, state.range(0), scope));
+    run(state, terms, 1000);
+}
+BENCHMARK(BM_random_terms)->RangeMultiplier(4)->Range(16, 256);
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+#include "alpha-equivalence.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of alpha-equivalence.hpp. Both traversals use an explicit
+ * stack instead of recursion, so deep terms do not overflow the call stack.
+ */
+
+namespace {
+
+// de Bruijn level of a variable that is not bound inside the traversed term
+constexpr std::ptrdiff_t unbound = -1;
+// smallest level referenced by a node that refers to no lambda outside of it
+constexpr std::ptrdiff_t self_contained =
+    std::numeric_limits<std::ptrdiff_t>::max();
+
+std::size_t mix(std::size_t seed, std::size_t value) noexcept {
+    value *= 0x9e3779b97f4a7c15ull;
+    value ^= value >> 32;
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+enum Salt : std::size_t {
+    free_variable = 1,
+    bound_variable,
+    lambda,
+    application,
+    reference
+};
+
+class Levels {
+    /**
+     * de Bruijn levels of the heads of the lambdas enclosing the current
+     * node of a traversal
+     */
+  public:
+    std::ptrdiff_t operator[](const Variable* head) const {
+        auto it = levels.find(head);
+        return it == levels.end() ? unbound : it->second;
+    }
+    /** @return previous level of head, to be passed to restore */
+    std::ptrdiff_t bind(const Variable* head, std::ptrdiff_t level) {
+        std::ptrdiff_t previous = (*this)[head];
+        levels[head] = level;
+        return previous;
+    }
+    void restore(const Variable* head, std::ptrdiff_t previous) {
+        if(previous == unbound) levels.erase(head);
+        else levels[head] = previous;
+    }
+  private:
+    std::unordered_map<const Variable*, std::ptrdiff_t> levels;
+};
+
+}
+
+class AlphaHasher {
+    /**
+     * computes the hash in post-order. Each result also carries the
+     * smallest level of a lambda the node refers to: if that lambda
+     * encloses the node, the hash depends on the context and is not cached.
+     */
+  public:
+    std::size_t operator()(const Expression& root) {
+        if(auto cached = root.cached_hash()) return cached;
+        todo.push_back({&root, 0, false, unbound});
+        while(!todo.empty()) {
+            Frame& frame = todo.back();
+            if(frame.expanded) finish(frame);
+            else expand(frame);
+        }
+        return results.back().hash;
+    }
+  private:
+    struct Frame {
+        const Expression* ex;
+        std::ptrdiff_t depth;
+        bool expanded;
+        // level of the lambda's head before it was bound
+        std::ptrdiff_t previous;
+    };
+    struct Result {
+        std::size_t hash;
+        std::ptrdiff_t min_level;
+    };
+
+    void expand(Frame& frame) {
+        const Expression* ex = frame.ex;
+        std::ptrdiff_t depth = frame.depth;
+        if(auto cached = ex->cached_hash()) {
+            todo.pop_back();
+            results.push_back({cached, self_contained});
+            return;
+        }
+        frame.expanded = true;
+        if(auto var = node_cast<Variable>(ex); var) {
+            todo.pop_back();
+            std::ptrdiff_t level = levels[var];
+            if(level == unbound) {
+                results.push_back({
+                    mix(free_variable, std::hash<std::string>()(
+                        var->get_name())),
+                    // a bound variable whose lambda is outside the root
+                    // would hash by index in a larger term
+                    var->is_bound() ? unbound : self_contained});
+            }
+            else {
+                results.push_back({mix(bound_variable, depth - 1 - level),
+                                   level});
+            }
+        }
+        else if(auto ref = node_cast<Reference>(ex); ref) {
+            todo.pop_back();
+            results.push_back({
+                mix(reference, std::hash<std::string>()(ref->get_name())),
+                self_contained});
+        }
+        else if(auto lbd = node_cast<Lambda>(ex); lbd) {
+            frame.previous = levels.bind(lbd->get_head().get(), depth);
+            todo.push_back({lbd->get_body().get(), depth + 1, false,
+                            unbound});
+        }
+        else {
+            auto app = node_cast<Application>(ex);
+            todo.push_back({app->get_argument().get(), depth, false,
+                            unbound});
+            todo.push_back({app->get_function().get(), depth, false,
+                            unbound});
+        }
+    }
+
+    void finish(Frame& frame) {
+        const Expression* ex = frame.ex;
+        Result result;
+        if(auto lbd = node_cast<Lambda>(ex); lbd) {
+            levels.restore(lbd->get_head().get(), frame.previous);
+            result = results.back();
+            results.pop_back();
+            result.hash = mix(lambda, result.hash);
+        }
+        else {
+            // the function was pushed last, so it is finished first
+            Result argument = results.back();
+            results.pop_back();
+            Result function = results.back();
+            results.pop_back();
+            result.hash = mix(mix(application, function.hash),
+                              argument.hash);
+            result.min_level = std::min(function.min_level,
+                                        argument.min_level);
+        }
+        if(result.hash == 0) result.hash = 1;
+        if(result.min_level >= frame.depth)
+            ex->hash.store(result.hash, std::memory_order_relaxed);
+        todo.pop_back();
+        results.push_back(result);
+    }
+
+    std::vector<Frame> todo;
+    std::vector<Result> results;
+    Levels levels;
+};
+
+std::size_t alpha_hash(const Expression& ex) {
+    return AlphaHasher()(ex);
+}
+
+bool alpha_equivalent(const Expression& a, const Expression& b) {
+    /**
+     * compares both terms in lockstep after a hash comparison
+     */
+    if(&a == &b) return true;
+    if(alpha_hash(a) != alpha_hash(b)) return false;
+
+    struct Frame {
+        const Expression* a;
+        const Expression* b;
+        std::ptrdiff_t depth;
+        // frames with exit set restore the levels of the heads of a and b
+        bool exit;
+        std::ptrdiff_t previous_a;
+        std::ptrdiff_t previous_b;
+    };
+    std::vector<Frame> todo{{&a, &b, 0, false, unbound, unbound}};
+    Levels levels_a, levels_b;
+    while(!todo.empty()) {
+        Frame frame = todo.back();
+        todo.pop_back();
+        if(frame.exit) {
+            levels_a.restore(static_cast<const Variable*>(frame.a),
+                             frame.previous_a);
+            levels_b.restore(static_cast<const Variable*>(frame.b),
+                             frame.previous_b);
+            continue;
+        }
+        const Expression* x = frame.a;
+        const Expression* y = frame.b;
+        auto hash_x = x->cached_hash();
+        auto hash_y = y->cached_hash();
+        // cached hashes belong to nodes without references to outer lambdas
+        if(x == y && hash_x) continue;
+        if(hash_x && hash_y && hash_x != hash_y) return false;
+        if(x->get_kind() != y->get_kind()) return false;
+        switch(x->get_kind()) {
+            case NodeKind::variable: {
+                auto u = static_cast<const Variable*>(x);
+                auto v = static_cast<const Variable*>(y);
+                std::ptrdiff_t level_u = levels_a[u];
+                std::ptrdiff_t level_v = levels_b[v];
+                if(level_u != unbound || level_v != unbound) {
+                    if(level_u != level_v) return false;
+                }
+                else if(u != v && (u->is_bound() || v->is_bound()
+                                   || u->get_name() != v->get_name())) {
+                    return false;
+                }
+                break;
+            }
+            case NodeKind::reference:
+                if(x != y) return false;
+                break;
+            case NodeKind::lambda: {
+                auto f = static_cast<const Lambda*>(x);
+                auto g = static_cast<const Lambda*>(y);
+                const Variable* head_f = f->get_head().get();
+                const Variable* head_g = g->get_head().get();
+                todo.push_back({head_f, head_g, 0, true,
+                                levels_a.bind(head_f, frame.depth),
+                                levels_b.bind(head_g, frame.depth)});
+                todo.push_back({f->get_body().get(), g->get_body().get(),
+                                frame.depth + 1, false, unbound, unbound});
+                break;
+            }
+            case NodeKind::application: {
+                auto f = static_cast<const Application*>(x);
+                auto g = static_cast<const Application*>(y);
+                todo.push_back({f->get_argument().get(),
+                                g->get_argument().get(), frame.depth, false,
+                                unbound, unbound});
+                todo.push_back({f->get_function().get(),
+                                g->get_function().get(), frame.depth, false,
+                                unbound, unbound});
+                break;
+            }
+        }
+    }
+    return true;
+}
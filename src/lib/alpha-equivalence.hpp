@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include "lambda-struct.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains structural hashing and comparison of terms modulo
+ * alpha conversion, i.e. \ x . x and \ y . y hash and compare equal. Bound
+ * variables are hashed by their de Bruijn index (the number of lambdas
+ * between them and their binder), free variables by their name.
+ * The hash of a node that refers to no lambda outside of itself does not
+ * depend on where the node occurs, so it is cached in the node (see
+ * Expression::cached_hash) and the next alpha_hash of a term only visits the
+ * nodes created since. alpha_equivalent compares two terms in O(1) if their
+ * hashes are cached and differ, and in linear time otherwise.
+ * A Reference (see lambda-struct.hpp) is a name, not its value: it is only
+ * equivalent to itself, and neither function resolves it.
+ * AlphaHash and AlphaEqual make Expression_ptr usable as key of unordered
+ * containers, e.g. to deduplicate results or to cache reductions by term.
+ */
+
+/**
+ * @return alpha-invariant structural hash of ex, never 0. Variables that are
+ * bound by a lambda outside of ex hash like free variables.
+ */
+std::size_t alpha_hash(const Expression& ex);
+
+/**
+ * @return true if a and b are equal up to the names of bound variables.
+ * Variables bound by lambdas outside of a and b are only equal if they are
+ * the same variable.
+ */
+bool alpha_equivalent(const Expression& a, const Expression& b);
+
+struct AlphaHash {
+    std::size_t operator()(const Expression_ptr& ex) const {
+        return alpha_hash(*ex);
+    }
+};
+
+struct AlphaEqual {
+    bool operator()(const Expression_ptr& a, const Expression_ptr& b) const {
+        return alpha_equivalent(*a, *b);
+    }
+};
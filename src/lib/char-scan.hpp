@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#if !defined(LAMBDA_NO_SIMD) && (defined(__SSE2__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+/**
+ * ABSTRACT:
+ * This header contains CharScan, which skips runs of characters of one class
+ * (whitespace, letters or digits) for BufferTokenizer (see tokenizer.hpp).
+ * With AVX2 it classifies 32 bytes at a time, with SSE2 (every x86-64 CPU)
+ * 16 bytes: a few vector comparisons give a bitmap with one bit per byte
+ * that ends the run, and the run ends at the lowest set bit. Shorter tails
+ * and other CPUs use the scalar loop, which is also the reference the vector
+ * code has to agree with. Compiling with LAMBDA_NO_SIMD forces the scalar
+ * loop; compile with -mavx2 (or -march=native) to use AVX2.
+ * The classes are fixed here: whitespace is " \t\n\v\f\r", letters are
+ * a-z and A-Z, digits 0-9. BufferTokenizer only uses CharScan if its
+ * character table agrees.
+ */
+
+enum class CharRun {
+    space,
+    letter,
+    digit
+};
+
+class CharScan {
+  public:
+    /**
+     * @return first position in [p, end) whose character is not of class
+     * run, end if there is none
+     */
+    template <CharRun run>
+    static const char* skip(const char* p, const char* end) noexcept {
+        // most runs in hand-written code are short, e.g. a single space
+        if(p == end || !is<run>(static_cast<unsigned char>(*p))) return p;
+#if !defined(LAMBDA_NO_SIMD) && defined(__AVX2__)
+        while(end - p >= 32) {
+            __m256i v = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(p));
+            auto stop = ~static_cast<unsigned>(
+                _mm256_movemask_epi8(matches<run>(v)));
+            if(stop) return p + __builtin_ctz(stop);
+            p += 32;
+        }
+#endif
+#if !defined(LAMBDA_NO_SIMD) && (defined(__SSE2__) || defined(__AVX2__))
+        while(end - p >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            auto stop = ~static_cast<unsigned>(
+                _mm_movemask_epi8(matches<run>(v))) & 0xffffu;
+            if(stop) return p + __builtin_ctz(stop);
+            p += 16;
+        }
+#endif
+        return skip_scalar<run>(p, end);
+    }
+
+    /** like skip, one character at a time */
+    template <CharRun run>
+    static const char* skip_scalar(const char* p, const char* end) noexcept {
+        while(p != end && is<run>(static_cast<unsigned char>(*p))) ++p;
+        return p;
+    }
+
+    /** @return true if c is of class run */
+    template <CharRun run>
+    static constexpr bool is(unsigned char c) noexcept {
+        switch(run) {
+            case CharRun::space:
+                return c == ' ' || (c >= '\t' && c <= '\r');
+            case CharRun::letter:
+                return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+            case CharRun::digit:
+                return c >= '0' && c <= '9';
+        }
+        return false;
+    }
+
+  private:
+    // in_range: signed comparisons, bytes >= 0x80 are negative and never
+    // inside the (ASCII) range
+#if !defined(LAMBDA_NO_SIMD) && (defined(__SSE2__) || defined(__AVX2__))
+    static __m128i in_range(__m128i v, char low, char high) noexcept {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(low - 1)),
+                             _mm_cmplt_epi8(v, _mm_set1_epi8(high + 1)));
+    }
+    template <CharRun run>
+    static __m128i matches(__m128i v) noexcept {
+        switch(run) {
+            case CharRun::space:
+                return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                    in_range(v, '\t', '\r'));
+            case CharRun::letter:
+                return in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                                'a', 'z');
+            case CharRun::digit:
+                break;
+        }
+        return in_range(v, '0', '9');
+    }
+#endif
+#if !defined(LAMBDA_NO_SIMD) && defined(__AVX2__)
+    static __m256i in_range(__m256i v, char low, char high) noexcept {
+        return _mm256_and_si256(
+            _mm256_cmpgt_epi8(v, _mm256_set1_epi8(low - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), v));
+    }
+    template <CharRun run>
+    static __m256i matches(__m256i v) noexcept {
+        switch(run) {
+            case CharRun::space:
+                return _mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                    in_range(v, '\t', '\r'));
+            case CharRun::letter:
+                return in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+                                'a', 'z');
+            case CharRun::digit:
+                break;
+        }
+        return in_range(v, '0', '9');
+    }
+#endif
+};
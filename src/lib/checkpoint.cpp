@@ -0,0 +1,109 @@
+#include <cstdio>
+#include <fstream>
+#include "checkpoint.hpp"
+#include "script-loader.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of checkpoint.hpp
+ */
+
+namespace {
+
+const char MAGIC[] = "LCCP";
+const std::size_t MAGIC_SIZE = 4;
+const std::uint8_t VERSION = 1;
+// name of the definition of the current term
+const std::string TERM = "term";
+
+void put_varint(std::ostream& os, std::uint64_t value) {
+    // unsigned LEB128, like BinaryWriter
+    do {
+        std::uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if(value) byte |= 0x80;
+        os.put(static_cast<char>(byte));
+    } while(value);
+}
+
+std::uint64_t get_varint(std::string_view buf, std::size_t& pos) {
+    std::uint64_t value = 0;
+    for(unsigned shift = 0; shift < 64 && pos < buf.size(); shift += 7) {
+        auto byte = static_cast<std::uint8_t>(buf[pos++]);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return value;
+    }
+    throw SerializationError("malformed checkpoint");
+}
+
+}
+
+void save_checkpoint(const std::string& path, const BetaReduction& beta,
+                     const ReductionState& state) {
+    /**
+     * writes to path.tmp first, renaming it to path replaces the old
+     * checkpoint in one step
+     */
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if(!out) throw FileError("Could not open file: " + tmp);
+        out.write(MAGIC, MAGIC_SIZE);
+        out.put(static_cast<char>(VERSION));
+        put_varint(out, state.steps);
+        put_varint(out, state.next_check);
+        BinaryWriter writer(out, true);
+        // a copy, without the checkpointer
+        auto reduction = std::make_shared<BetaReduction>(
+            beta.num_steps, beta.max_iter, beta.strategy);
+        writer.write(TERM, Command(state.term, reduction));
+        writer.write(state.compared ? state.compared : state.term);
+        writer.finish();
+        if(!out) throw FileError("Could not write file: " + tmp);
+    }
+    if(std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw FileError("Could not write file: " + path);
+}
+
+Checkpoint load_checkpoint(const std::string& path, Program& program) {
+    MappedFile file(path);
+    std::string_view buf = file.view();
+    if(buf.substr(0, MAGIC_SIZE) != std::string_view(MAGIC, MAGIC_SIZE))
+        throw SerializationError("not a checkpoint: " + path);
+    std::size_t pos = MAGIC_SIZE;
+    if(pos >= buf.size() || static_cast<std::uint8_t>(buf[pos++]) != VERSION)
+        throw SerializationError("unsupported checkpoint version");
+    Checkpoint checkpoint;
+    checkpoint.state.steps = get_varint(buf, pos);
+    checkpoint.state.next_check = get_varint(buf, pos);
+    BinaryReader reader(buf.substr(pos), &program);
+    if(!reader.next() || reader.name() != TERM)
+        throw SerializationError("checkpoint without term");
+    checkpoint.state.term = reader.expression();
+    checkpoint.reduction = std::dynamic_pointer_cast<BetaReduction>(
+        reader.last_command().c);
+    if(!checkpoint.reduction)
+        throw SerializationError("checkpoint without beta reduction");
+    if(!reader.next() || !reader.name().empty())
+        throw SerializationError("checkpoint without cycle detection");
+    checkpoint.state.compared = reader.expression();
+    return checkpoint;
+}
+
+bool FileCheckpointer::due(unsigned long steps) {
+    /**
+     * the clock is only read every 256 steps, which is often enough for
+     * intervals of human scale
+     */
+    if(steps == 0) return false;
+    if(every_steps && steps % every_steps == 0) return true;
+    return interval.count() && steps % 256 == 0
+        && std::chrono::steady_clock::now() - last >= interval;
+}
+
+void FileCheckpointer::save(const BetaReduction& beta,
+                            const ReductionState& state) {
+    save_checkpoint(path, beta, state);
+    last = std::chrono::steady_clock::now();
+    ++count;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <string>
+#include "serialization.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains checkpoints of long beta reductions: a
+ * FileCheckpointer, set as the checkpointer of a BetaReduction (see
+ * program.hpp), saves the state of the reduction to a file every so many
+ * steps or seconds, and load_checkpoint reads it back, so that the
+ * reduction can be resumed after a crash or restart:
+ *
+ *     beta->checkpointer = std::make_shared<FileCheckpointer>(
+ *         "reduction.checkpoint", 1000000);
+ *     ... the process is killed ...
+ *     Checkpoint checkpoint = load_checkpoint("reduction.checkpoint",
+ *                                             program);
+ *     Expression_ptr res = checkpoint.resume();
+ *
+ * Resuming takes the same steps as the uninterrupted reduction would have,
+ * so it ends with the same term, or throws MaxIterationsExceeded at the same
+ * step.
+ * A checkpoint file starts with the magic bytes "LCCP" and a version byte,
+ * followed by ReductionState::steps and ReductionState::next_check as
+ * unsigned LEB128 varints and a stream in the format of serialization.hpp,
+ * which keeps shared subterms shared. The stream has the definition "term",
+ * i.e. the current term with the BetaReduction as its conversion, and the
+ * expression the cycle detection compares to. References are kept as names
+ * and resolved in the program passed to load_checkpoint, which therefore
+ * needs the same definitions as the program of the saved reduction.
+ * A new checkpoint replaces the file atomically (it is written next to it
+ * and renamed), so the file always holds a complete checkpoint.
+ */
+
+void save_checkpoint(const std::string& path, const BetaReduction& beta,
+                     const ReductionState& state);
+
+struct Checkpoint {
+    /**
+     * a saved BetaReduction and its state
+     */
+    std::shared_ptr<BetaReduction> reduction;
+    ReductionState state;
+
+    /** @return result of the reduction, see BetaReduction::resume */
+    Expression_ptr resume() const {
+        return reduction->resume(state);
+    }
+    /** like resume(), adds statistics of the remaining steps to stats */
+    Expression_ptr resume(ReductionStats& stats) const {
+        return reduction->resume(state, stats);
+    }
+};
+
+/**
+ * reads the checkpoint at path, resolving references in program. Throws
+ * FileError if there is no such file and SerializationError if it is not
+ * a checkpoint
+ */
+Checkpoint load_checkpoint(const std::string& path, Program& program);
+
+class FileCheckpointer final : public Checkpointer {
+    /**
+     * saves a checkpoint to path every every_steps steps (0 for never) and
+     * once at least interval has passed since the last one (0 for never)
+     */
+  public:
+    explicit FileCheckpointer(std::string path, unsigned long every_steps,
+                              std::chrono::milliseconds interval
+                              = std::chrono::milliseconds(0))
+        : path(std::move(path)), every_steps(every_steps),
+          interval(interval), last(std::chrono::steady_clock::now()),
+          count(0) {}
+    bool due(unsigned long steps) override;
+    void save(const BetaReduction& beta,
+              const ReductionState& state) override;
+    const std::string& get_path() const noexcept {
+        return path;
+    }
+    /** @return number of checkpoints saved */
+    unsigned long saved() const noexcept {
+        return count;
+    }
+  private:
+    std::string path;
+    unsigned long every_steps;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point last;
+    unsigned long count;
+};
@@ -12,23 +12,23 @@
  * @return Expression pointer that represents this natural in church encoding
  */
 Lambda_ptr church_encode(unsigned int n) {
-    Variable_ptr f = std::make_shared<Variable>("f", true);
-    Variable_ptr x = std::make_shared<Variable>("x", true);
+    Variable_ptr f = make_node<Variable>("f", true);
+    Variable_ptr x = make_node<Variable>("x", true);
     Expression_ptr bdy = x;
     for(unsigned int i = 0; i < n; ++i) bdy =
-            std::make_shared<Application>(f, bdy);
-    auto tmp = std::make_shared<Lambda>(x, bdy);
-    return std::make_shared<Lambda>(f, tmp);
+            make_node<Application>(f, bdy);
+    auto tmp = make_node<Lambda>(x, bdy);
+    return make_node<Lambda>(f, tmp);
 }
 
 /**
  * encodes true, lambda a . lambda b . a
  */
 Lambda_ptr church_true() {
-    Variable_ptr a = std::make_shared<Variable>("a", true);
-    Variable_ptr b = std::make_shared<Variable>("b", true);
-    Lambda_ptr inner = std::make_shared<Lambda>(b, a);
-    Lambda_ptr outer = std::make_shared<Lambda>(a, inner);
+    Variable_ptr a = make_node<Variable>("a", true);
+    Variable_ptr b = make_node<Variable>("b", true);
+    Lambda_ptr inner = make_node<Lambda>(b, a);
+    Lambda_ptr outer = make_node<Lambda>(a, inner);
     return outer;
 }
 
@@ -36,9 +36,9 @@ Lambda_ptr church_true() {
  * encodes false, lambda a . lambda b . b
  */
 Lambda_ptr church_false() {
-    Variable_ptr a = std::make_shared<Variable>("a", true);
-    Variable_ptr b = std::make_shared<Variable>("b", true);
-    Lambda_ptr inner = std::make_shared<Lambda>(b, b);
-    Lambda_ptr outer = std::make_shared<Lambda>(a, inner);
+    Variable_ptr a = make_node<Variable>("a", true);
+    Variable_ptr b = make_node<Variable>("b", true);
+    Lambda_ptr inner = make_node<Lambda>(b, b);
+    Lambda_ptr outer = make_node<Lambda>(a, inner);
     return outer;
 }
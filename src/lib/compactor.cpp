@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include "compactor.hpp"
+#include "node-allocator.hpp"
+#include "reclaimer.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of compactor.hpp
+ */
+
+std::ostream& operator<<(std::ostream& os, const CompactionStats& stats) {
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+    return os << "compactions:       " << stats.compactions << "\n"
+              << "nodes relocated:   " << stats.nodes << "\n"
+              << "live node memory:  " << stats.live_bytes << " bytes\n"
+              << "released memory:   " << stats.released_bytes << " bytes\n"
+              << "pause time:        "
+              << duration_cast<microseconds>(stats.last_pause).count()
+              << " us, max "
+              << duration_cast<microseconds>(stats.max_pause).count()
+              << " us, total "
+              << duration_cast<microseconds>(stats.total_pause).count()
+              << " us";
+}
+
+class Compactor::Relocator {
+    /**
+     * copies terms into new slabs, bottom-up without recursion like
+     * copy_term (see reduction.hpp). copies maps every traced node to its
+     * copy, so sharing is preserved across all roots
+     */
+  public:
+    Expression_ptr relocate(const Expression& ex);
+    std::unordered_map<const Expression*, Expression_ptr> copies;
+  private:
+    Expression_ptr copy(const Expression& e);
+    std::vector<std::pair<const Expression*, bool>> stack;
+};
+
+Expression_ptr Compactor::Relocator::relocate(const Expression& ex) {
+    stack.emplace_back(&ex, false);
+    while(!stack.empty()) {
+        auto [e, expanded] = stack.back();
+        stack.pop_back();
+        if(copies.count(e)) continue;
+        if(!expanded) {
+            stack.emplace_back(e, true);
+            if(auto lbd = node_cast<Lambda>(e)) {
+                stack.emplace_back(lbd->get_body().get(), false);
+                stack.emplace_back(lbd->get_head().get(), false);
+            }
+            else if(auto app = node_cast<Application>(e)) {
+                stack.emplace_back(app->get_argument().get(), false);
+                stack.emplace_back(app->get_function().get(), false);
+            }
+            else if(auto ref = node_cast<Reference>(e)) {
+                if(ref->is_resolved())
+                    stack.emplace_back(ref->value.get(), false);
+            }
+            continue;
+        }
+        Expression_ptr c = copy(*e);
+        c->hash.store(e->hash.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+        copies.emplace(e, std::move(c));
+    }
+    return copies[&ex];
+}
+
+Expression_ptr Compactor::Relocator::copy(const Expression& e) {
+    /**
+     * the children of e have been copied already
+     */
+    switch(e.get_kind()) {
+        case NodeKind::variable: {
+            auto& var = static_cast<const Variable&>(e);
+            return make_node<Variable>(var.get_name(), var.is_bound(),
+                                       var.get_origin());
+        }
+        case NodeKind::lambda: {
+            auto& lbd = static_cast<const Lambda&>(e);
+            return make_node<Lambda>(
+                static_pointer_cast<const Variable>(
+                    copies[lbd.get_head().get()]),
+                copies[lbd.get_body().get()], lbd.get_origin());
+        }
+        case NodeKind::application: {
+            auto& app = static_cast<const Application&>(e);
+            return make_node<Application>(copies[app.get_function().get()],
+                                          copies[app.get_argument().get()],
+                                          app.get_origin());
+        }
+        case NodeKind::reference:
+            break;
+    }
+    auto& ref = static_cast<const Reference&>(e);
+    if(!ref.is_resolved())
+        return make_node<Reference>(ref.get_name(), ref.resolver,
+                                    ref.get_origin(), ref.get_definition());
+    auto res = make_node<Reference>(ref.get_name(), Reference::Resolver(),
+                                    ref.get_origin(), ref.get_definition());
+    res->value = copies[ref.value.get()];
+    res->resolved.store(true, std::memory_order_release);
+    return res;
+}
+
+bool Compactor::due() const noexcept {
+    return NodePool::slab_bytes() >= threshold;
+}
+
+bool Compactor::collect(Program& program,
+                        const std::vector<Expression_ptr*>& roots) {
+    if(!due()) return false;
+    compact(program, roots);
+    return true;
+}
+
+void Compactor::compact(Program& program,
+                        const std::vector<Expression_ptr*>& roots) {
+    std::vector<Expression_ptr*> all = program.roots();
+    all.insert(all.end(), roots.begin(), roots.end());
+    compact(all);
+}
+
+void Compactor::compact(const std::vector<Expression_ptr*>& roots) {
+    /**
+     * the copies are made within a NodePool::Relocation, so they get new
+     * slabs. Dropping the old nodes must actually free them before the
+     * empty slabs can be found, whatever the Reclamation mode
+     */
+    auto start = std::chrono::steady_clock::now();
+    std::size_t allocated = node_memory().bytes_allocated;
+    unsigned long nodes;
+    {
+        // the old terms die at the end of the block, after the relocation,
+        // else their blocks would be reused for the copies
+        std::vector<Expression_ptr> old;
+        old.reserve(roots.size());
+        Relocator relocator;
+        NodePool::Relocation relocation;
+        for(Expression_ptr* root: roots) {
+            if(!*root) continue;
+            Expression_ptr copy = relocator.relocate(**root);
+            old.push_back(std::exchange(*root, std::move(copy)));
+        }
+        nodes = relocator.copies.size();
+    }
+    if(Reclaimer::get_mode() == Reclamation::background) Reclaimer::wait();
+    else Reclaimer::collect();
+    std::size_t released = NodePool::release_free_slabs();
+    auto pause = std::chrono::steady_clock::now() - start;
+
+    ++stats.compactions;
+    stats.nodes = nodes;
+    stats.live_bytes = node_memory().bytes_allocated - allocated;
+    stats.released_bytes += released;
+    stats.last_pause = pause;
+    stats.max_pause = std::max(stats.max_pause, stats.last_pause);
+    stats.total_pause += stats.last_pause;
+    threshold = std::max(policy.min_bytes, static_cast<std::size_t>(
+        policy.growth * static_cast<double>(NodePool::slab_bytes())));
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include "program.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the Compactor, which keeps the node memory (see
+ * node-allocator.hpp) of long-running sessions proportional to their live
+ * terms. Reference counting frees every node as soon as it is dead, but the
+ * free blocks are scattered over the slabs of the pools, so the slabs stay
+ * allocated and a few live nodes can pin lots of memory.
+ * Compacting traces the terms reachable from the roots, i.e. the symbols of
+ * a Program (see Program::roots) and the terms of evaluations in flight,
+ * e.g. the current term of a Reducer (see reducer.hpp), copies them into new
+ * slabs and replaces the roots by the copies. The copies preserve sharing
+ * (also between roots), origins and cached hashes, and are contiguous in the
+ * order they are traced. Once the roots refer to the copies, the old nodes
+ * are dead, so they are freed and their slabs are given back.
+ * Terms are built bottom-up and a Reference's value never contains the
+ * Reference, so the heap has no cycles and reference counting stays the
+ * collector of dead nodes; the Compactor only moves live ones.
+ * Compacting stops the calling thread and must not run while other threads
+ * use the terms. Terms referred to from elsewhere than the roots stay valid
+ * but keep their old nodes (and slabs) alive.
+ *
+ *     Compactor compactor;
+ *     ...
+ *     // after each evaluation, compacts when the trigger fires
+ *     compactor.collect(program);
+ */
+
+struct CompactionPolicy {
+    /**
+     * when Compactor::collect compacts: once the pools hold at least
+     * min_bytes of slabs and growth times the slab bytes that were left
+     * after the last compaction
+     */
+    std::size_t min_bytes = 4 * 1024 * 1024;
+    double growth = 2.0;
+};
+
+struct CompactionStats {
+    /**
+     * statistics of all compactions of a Compactor
+     */
+    unsigned long compactions = 0;
+    // nodes and node memory relocated by the last compaction
+    unsigned long nodes = 0;
+    std::size_t live_bytes = 0;
+    // slab bytes given back to the system, in total
+    std::size_t released_bytes = 0;
+    // pause times
+    std::chrono::nanoseconds last_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds total_pause{0};
+};
+
+std::ostream& operator<<(std::ostream& os, const CompactionStats& stats);
+
+class Compactor {
+  public:
+    explicit Compactor(CompactionPolicy policy = CompactionPolicy())
+        : policy(policy), stats(), threshold(policy.min_bytes) {}
+
+    /** @return true if the pools have grown enough to compact, see
+     * CompactionPolicy */
+    bool due() const noexcept;
+
+    /**
+     * compacts if due
+     * @param program its terms are roots
+     * @param roots further roots, e.g. terms of evaluations in flight
+     * @return true if it compacted
+     */
+    bool collect(Program& program,
+                 const std::vector<Expression_ptr*>& roots = {});
+
+    /** compacts now, see collect */
+    void compact(Program& program,
+                 const std::vector<Expression_ptr*>& roots = {});
+
+    /** compacts now, with roots as the only roots */
+    void compact(const std::vector<Expression_ptr*>& roots);
+
+    const CompactionStats& get_stats() const noexcept {
+        return stats;
+    }
+    const CompactionPolicy& get_policy() const noexcept {
+        return policy;
+    }
+  private:
+    class Relocator;
+    CompactionPolicy policy;
+    CompactionStats stats;
+    // slab bytes at which collect compacts
+    std::size_t threshold;
+};
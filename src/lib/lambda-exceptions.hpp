@@ -46,3 +46,13 @@ class InvalidReservedSymbol : public LambdaException {
   private:
     std::string txt;
 };
+
+class FileError : public LambdaException {
+  public:
+    FileError(std::string txt) : txt(txt) {}
+    const char* what() const noexcept override {
+      return txt.c_str();
+    }
+  private:
+    std::string txt;
+};
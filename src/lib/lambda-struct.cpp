@@ -1,9 +1,92 @@
+#include <mutex>
 #include "lambda-struct.hpp"
+#include "printer.hpp"
+#include "reduction.hpp"
+
+Definition& Definition::create(std::string name, std::string source,
+                               SourceSpan span) {
+    // parsers on several threads may create definitions at the same time
+    static std::mutex mutex;
+    static std::deque<Definition> definitions;
+    std::lock_guard<std::mutex> lock(mutex);
+    return definitions.emplace_back(std::move(name), std::move(source), span);
+}
 
 /**
  * This method was moved to the .cpp file to avoid linking errors
  * that occur when e.g. linking all test files together
+ * Output is done by the iterative Printer, so deep terms can be printed
  */
 std::ostream& operator<<(std::ostream& os, const Expression& ex) {
-    return ex.print(os);
+    print_expression(os, ex);
+    return os;
+}
+
+/**
+ * Beta reduction and instantiation forward to the reduction engine without
+ * statistics, see reduction.hpp
+ */
+Expression_ptr Variable::beta_reduce() const {
+    NoStats stats;
+    return beta_step(*this, stats);
+}
+
+Expression_ptr Lambda::beta_reduce() const {
+    NoStats stats;
+    return beta_step(*this, stats);
+}
+
+Expression_ptr Application::beta_reduce() const {
+    NoStats stats;
+    return beta_step(*this, stats);
+}
+
+Expression_ptr Variable::instantiate(Variable_ptr e1, Expression_ptr e2,
+                                     Renaming& renaming) const {
+    NoStats stats;
+    return instantiate_term(*this, e1.get(), e2, renaming, stats);
+}
+
+Expression_ptr Lambda::instantiate(Variable_ptr e1, Expression_ptr e2,
+                                   Renaming& renaming) const {
+    NoStats stats;
+    return instantiate_term(*this, e1.get(), e2, renaming, stats);
+}
+
+Expression_ptr Application::instantiate(Variable_ptr e1, Expression_ptr e2,
+                                        Renaming& renaming) const {
+    NoStats stats;
+    return instantiate_term(*this, e1.get(), e2, renaming, stats);
+}
+
+Expression_ptr Reference::beta_reduce() const {
+    NoStats stats;
+    return beta_step(*this, stats);
+}
+
+Expression_ptr Reference::instantiate(Variable_ptr e1, Expression_ptr e2,
+                                      Renaming& renaming) const {
+    NoStats stats;
+    return instantiate_term(*this, e1.get(), e2, renaming, stats);
+}
+
+const Expression_ptr& Reference::get_value() const {
+    /**
+     * call_once, because threads reducing terms that share the node may
+     * need the value at the same time. A Compactor creates references
+     * that are resolved from the start
+     */
+    if(is_resolved()) return value;
+    std::call_once(once, [this]() {
+        Expression_ptr v = resolver();
+        // e.g. 'B' = A; the value of B is the value of A
+        while(auto ref = node_cast<Reference>(v.get())) {
+            Expression_ptr next = ref->get_value();
+            v = std::move(next);
+        }
+        value = std::move(v);
+        resolver = nullptr;
+        resolved.store(true, std::memory_order_release);
+    });
+    return value;
 }
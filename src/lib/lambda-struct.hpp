@@ -1,19 +1,40 @@
 #pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include "lambda-exceptions.hpp"
+#include "node-allocator.hpp"
+#include "reclaimer.hpp"
+#include "ref.hpp"
 
 /**
  * ABSTRACT:
- * This file contains a class-polymorphism to represent lambda expressions.
+ * This file contains a class hierarchy to represent lambda expressions.
  * User-supplied commands like "beta reduce this expression" are intentionally
  * split away into the file "statement.hpp", so that this header can be re-used
  * for other purposes more directly.
  * This header defines a base class for all valid lambda expressions, called
  * "Expression". Child classes are "Lambda" (e.g. \\ x. x), "Application"
- * (e.g. ((f) x) and "Variable" (e.g. x).
- * The important polymorphic methods are Expression::beta_reduce for invoking
- * one step of beta reduction, Expression::alpha_convert for alpha conversion.
+ * (e.g. ((f) x), "Variable" (e.g. x) and "Reference" (a NAME like ID, whose
+ * value is only computed once reduction needs it, see Program::reference).
+ * Every node stores its NodeKind, and operations dispatch on it with a switch
+ * instead of virtual calls: visit calls a (generic) visitor with the concrete
+ * node, node_cast replaces dynamic_cast. New passes over terms are written
+ * as visitors. The methods of Expression, e.g. Expression::beta_reduce for
+ * invoking one step of beta reduction and Expression::alpha_convert for alpha
+ * conversion, are themselves such dispatchers to the classes' methods.
+ * Beta reduction itself is implemented in "reduction.hpp", which can also
+ * collect statistics.
+ * Every node may point to its Origin: the Definition (statement) and the span
+ * of source text it was parsed from. Nodes created by reduction keep the
+ * origin of the node they are a copy of, so work done during reduction can
+ * be attributed to the code that caused it (see profiler.hpp).
+ * Nodes are deleted by the Reclaimer (see reclaimer.hpp), iteratively, so
+ * releasing a deep term does not overflow the stack.
  */
 
 // forward declarations
@@ -21,84 +42,238 @@ class Expression;
 class Variable;
 class Application;
 class Lambda;
-typedef std::shared_ptr<const Expression> Expression_ptr;
-typedef std::shared_ptr<const Application> Application_ptr;
-typedef std::shared_ptr<const Variable> Variable_ptr;
-typedef std::shared_ptr<const Lambda> Lambda_ptr;
+class Reference;
+// see program.hpp
+class Command;
+// intrusively reference counted, see ref.hpp
+typedef Ref<const Expression> Expression_ptr;
+typedef Ref<const Application> Application_ptr;
+typedef Ref<const Variable> Variable_ptr;
+typedef Ref<const Lambda> Lambda_ptr;
+typedef Ref<const Reference> Reference_ptr;
+// for terms that several threads copy and release concurrently
+typedef Ref<const Expression, true> SharedExpression_ptr;
+// maps head variables to their replacement, see Expression::instantiate
+typedef std::unordered_map<const Variable*, Variable_ptr> Renaming;
 
-class Expression: public std::enable_shared_from_this<Expression> {
+struct SourceSpan {
+    /**
+     * characters begin to end (exclusive) of an input, line and column
+     * (both counted from 1) are those of begin
+     */
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::uint32_t line = 0;
+    std::uint32_t column = 0;
+};
+
+class Definition;
+
+struct Origin {
+    /**
+     * where a node was parsed from
+     */
+    const Definition* definition;
+    SourceSpan span;
+};
+
+class Definition {
+    /**
+     * one parsed statement: the NAME it assigns to (empty for expressions)
+     * and the name of its source (e.g. a file, may be empty).
+     * Definitions and their origins are never freed, because nodes that
+     * refer to them may live arbitrarily long. Parsers therefore only
+     * create them when asked to (see Parser::track_origins).
+     */
+  public:
+    Definition(std::string name, std::string source, SourceSpan span)
+        : name(std::move(name)), source(std::move(source)), span(span),
+          origins() {}
+    Definition(const Definition&) = delete;
+    Definition& operator=(const Definition&) = delete;
+    /** @return new definition that lives until the end of the program */
+    static Definition& create(std::string name, std::string source,
+                              SourceSpan span);
+    const std::string& get_name() const noexcept {
+        return name;
+    }
+    const std::string& get_source() const noexcept {
+        return source;
+    }
+    /** @return span of the whole statement (end is set once parsed) */
+    const SourceSpan& get_span() const noexcept {
+        return span;
+    }
+    void set_end(std::size_t end) noexcept {
+        span.end = end;
+    }
+    /** @return new origin within this definition */
+    const Origin* locate(const SourceSpan& node_span) {
+        origins.push_back({this, node_span});
+        return &origins.back();
+    }
+  private:
+    std::string name;
+    std::string source;
+    SourceSpan span;
+    // deque, so origins keep their address
+    std::deque<Origin> origins;
+};
+
+enum class NodeKind : std::uint8_t {
+    /**
+     * the concrete class of an Expression
+     */
+    variable,
+    lambda,
+    application,
+    reference
+};
+
+class Expression: public RefCounted {
     /**
      * abstract base class for all valid expressions
      */
   public:
+    Expression(const Expression&) = delete;
+    Expression& operator=(const Expression&) = delete;
+
+    /** @return new reference to this node, which must be owned by Refs */
+    Expression_ptr shared_from_this() const noexcept {
+        return Expression_ptr(this);
+    }
+
+    /** @return kind of the node, see visit */
+    NodeKind get_kind() const noexcept {
+        return kind;
+    }
+
+    /*
+     * The following methods dispatch on the kind to the method of the same
+     * name of Variable, Lambda or Application, without a virtual call.
+     */
+
     /** @return true iff the expression contains a variable with a name equal
      * to the given string */
-    virtual bool check_for_name_clash(const std::string&) const noexcept = 0;
+    bool check_for_name_clash(const std::string&) const;
 
-    /** @return Expression after one step of beta reduction*/
-    virtual Expression_ptr beta_reduce() const = 0;
+    /** @return Expression after one step of normal order beta reduction,
+     * itself if it is in normal form. Implemented by beta_step in
+     * reduction.hpp */
+    Expression_ptr beta_reduce() const;
 
     /** @return Expression where first argument was replaced by second
      * argument*/
-    virtual Expression_ptr substitute(Variable_ptr, Expression_ptr) const = 0;
+    Expression_ptr substitute(Variable_ptr, Expression_ptr) const;
+
+    /** @return copy of the Expression where first argument was replaced by
+     * second argument and every lambda got a fresh head variable.
+     * Used for beta reduction, so that the copies of a lambda that
+     * reduction creates never end up nested in each other, which would
+     * make their variables indistinguishable */
+    Expression_ptr instantiate(Variable_ptr, Expression_ptr, Renaming&) const;
 
     /** @return Expression where bound variables with a name equal to the first
      * argument were renamed to the second
      * if third argument is true, throws Exception on name clash */
-    virtual Expression_ptr alpha_convert(const std::string&,
-                                         const std::string&) const = 0;
+    Expression_ptr alpha_convert(const std::string&, const std::string&) const;
 
+    // virtual only so that Ref and dynamic_pointer_cast keep working
     virtual ~Expression() {}
 
+    /** called by Ref for the last reference, deletes ex without recursing
+     * into its children, see reclaimer.hpp */
+    static void dispose(const Expression* ex) noexcept {
+        Reclaimer::release(ex);
+    }
+
     /** prints itself to ostream, returns osstream **/
-    virtual std::ostream& print(std::ostream&) const = 0;
+    std::ostream& print(std::ostream&) const;
+
+    /** @return where the node was parsed from, nullptr if unknown */
+    const Origin* get_origin() const noexcept {
+        return origin;
+    }
+
+    /** @return alpha-invariant hash of the node if alpha_hash (see
+     * alpha-equivalence.hpp) has cached it, else 0 */
+    std::size_t cached_hash() const noexcept {
+        return hash.load(std::memory_order_relaxed);
+    }
+
+#ifndef LAMBDA_NO_NODE_POOL
+    static void* operator new(std::size_t size) {
+        return NodePool::allocate(size);
+    }
+    static void operator delete(void* p, std::size_t size) noexcept {
+        NodePool::deallocate(p, size);
+    }
+#endif
+  protected:
+    explicit Expression(NodeKind kind, const Origin* origin = nullptr) noexcept
+        : kind(kind), origin(origin), hash(0) {}
+  private:
+    friend class AlphaHasher;
+    friend class Reclaimer;
+    friend class InPlace;
+    friend class Compactor;
+    NodeKind kind;
+    const Origin* origin;
+    // atomic, because threads sharing a term may hash it concurrently.
+    // Links the Reclaimer's worklist once the node is dead
+    mutable std::atomic<std::size_t> hash;
 };
 
 std::ostream& operator<<(std::ostream& os, const Expression& ex);
 
+template <typename T, typename... Args>
+Ref<const T> make_node(Args&&... args) {
+    /**
+     * creates a Variable, Lambda or Application, like std::make_shared.
+     * Nodes are immutable, so the Ref is to const
+     */
+    return Ref<const T>(new T(std::forward<Args>(args)...));
+}
+
 class Variable final : public Expression {
     /**
      * Variables have a name and can be bound or not
      * e.g. x
      */
   public:
-    Variable(std::string name, bool bound) : Expression(), name(name),
-        bound(bound) {}
+    static constexpr NodeKind node_kind = NodeKind::variable;
+    Variable(std::string name, bool bound, const Origin* origin = nullptr)
+        : Expression(node_kind, origin), name(name), bound(bound) {}
     bool is_bound() const noexcept {
         return bound;
     }
-    std::string get_name() const noexcept {
+    const std::string& get_name() const noexcept {
         return name;
     }
-    Expression_ptr beta_reduce() const override {
-        /**
-         * beta reduction of variable is identity
-         */
-        return shared_from_this();
-    }
+    Expression_ptr beta_reduce() const;
     Expression_ptr alpha_convert(const std::string& old_name,
-                                 const std::string& new_name) const override {
+                                 const std::string& new_name) const {
         /**
          * identity, actual renaming is done via Variable::substitute()
          */
         return shared_from_this();
     }
-    Expression_ptr substitute(Variable_ptr e1, Expression_ptr e2) const
-        override {
+    Expression_ptr substitute(Variable_ptr e1, Expression_ptr e2) const {
         /**
          * returns e2 if e1 matches itself, else returns copy of itself
          */
         if(this == e1.get()) return e2;
         return shared_from_this();
     }
-    bool check_for_name_clash(const std::string& new_name) const noexcept
-        override {
+    Expression_ptr instantiate(Variable_ptr e1, Expression_ptr e2,
+                               Renaming& renaming) const;
+    bool check_for_name_clash(const std::string& new_name) const {
 	/**
 	 * returns true if new_name matches this->name
 	 */
         return this->name == new_name;
     }
-    std::ostream& print(std::ostream& os) const override {
+    std::ostream& print(std::ostream& os) const {
 	/**
 	 * used for output
 	 */
@@ -117,58 +292,55 @@ class Lambda final : public Expression {
      * \ head . body
      */
   public:
-    Lambda(Variable_ptr head, Expression_ptr body) : head(head), body(body) {}
-    Expression_ptr beta_reduce() const override {
-        /**
-         * beta reduction needs an application, so it gets passed down to body
-         */
-        auto res = body->beta_reduce();
-        if(res == body) return shared_from_this();
-        return std::make_shared<Lambda>(head, res);
-    }
-    Expression_ptr substitute(Variable_ptr e1, Expression_ptr e2) const
-        override {
+    static constexpr NodeKind node_kind = NodeKind::lambda;
+    Lambda(Variable_ptr head, Expression_ptr body,
+           const Origin* origin = nullptr)
+        : Expression(node_kind, origin), head(head), body(body) {}
+    Expression_ptr beta_reduce() const;
+    Expression_ptr substitute(Variable_ptr e1, Expression_ptr e2) const {
         /**
-         * if e1 matches head, subsitute head and returns body
-         * else passes substitute on to body
+         * if e1 matches head, e1 is bound by this lambda, so nothing is
+         * substituted, else passes substitute on to body
          */
+        if(e1 == head) return shared_from_this();
         auto res = body->substitute(e1, e2);
-        if(e1 == head) return res;
-        else if(res == body) return shared_from_this();
-        return std::make_shared<Lambda>(head, res);
+        if(res == body) return shared_from_this();
+        return make_node<Lambda>(head, res, get_origin());
     }
+    Expression_ptr instantiate(Variable_ptr e1, Expression_ptr e2,
+                               Renaming& renaming) const;
     Expression_ptr alpha_convert(const std::string& old_name,
-                                 const std::string& new_name) const override {
+                                 const std::string& new_name) const {
         /**
          * if head matches the new name, calls subsitute
          * else passes conversion to body
          */
         if(head->get_name() == old_name) {
             if(this->check_for_name_clash(new_name)) throw NameClash();
-            auto new_head = std::make_shared<Variable>(new_name, true);
+            auto new_head = make_node<Variable>(new_name, true,
+                                                head->get_origin());
             auto new_body = body->substitute(head, new_head);
-            return std::make_shared<Lambda>(new_head, new_body);
+            return make_node<Lambda>(new_head, new_body, get_origin());
         }
         auto new_body = body->alpha_convert(old_name, new_name);
         if(new_body == body) return shared_from_this();
-        return std::make_shared<Lambda>(head, new_body);
+        return make_node<Lambda>(head, new_body, get_origin());
     }
-    Variable_ptr get_head() const noexcept {
+    const Variable_ptr& get_head() const noexcept {
         /**
          * returns head, the variable in the abstraction
          * e.g. \ x . x y -> x is head
          */
         return head;
     }
-    Expression_ptr get_body() const noexcept {
+    const Expression_ptr& get_body() const noexcept {
         /**
          * returns body, the expression after the abstraction
          * e.g. \ x . x y -> x y is body
          */
         return body;
     }
-    bool check_for_name_clash(const std::string& new_name) const noexcept
-        override {
+    bool check_for_name_clash(const std::string& new_name) const {
 	/**
 	 * checks if new_name is already used in the expression
 	 */
@@ -176,13 +348,14 @@ class Lambda final : public Expression {
         bool clash_body = body->check_for_name_clash(new_name);
         return clash_body && !clash_head;
     }
-    std::ostream& print(std::ostream& os) const override {
+    std::ostream& print(std::ostream& os) const {
 	/**
 	 * used for output
 	 */
         return os << "\\" << *head << " . " << *body;
     }
   private:
+    friend class InPlace;
     Variable_ptr head;
     Expression_ptr body;
 };
@@ -194,11 +367,12 @@ class Application final : public Expression {
      * e.g. x y or (\ x . x) y
      */
   public:
-    Application(Expression_ptr fst, Expression_ptr snd) :
-        Expression(), function(fst), argument(snd) {}
+    static constexpr NodeKind node_kind = NodeKind::application;
+    Application(Expression_ptr fst, Expression_ptr snd,
+                const Origin* origin = nullptr) :
+        Expression(node_kind, origin), function(fst), argument(snd) {}
 
-    Expression_ptr substitute(Variable_ptr e_old, Expression_ptr e_new)
-        const override {
+    Expression_ptr substitute(Variable_ptr e_old, Expression_ptr e_new) const {
         /**
          * substitutes e_old for e_new in both expressions of this application
          * returns new Expression
@@ -208,32 +382,13 @@ class Application final : public Expression {
         auto snd_new = argument->substitute(e_old, e_new);
         if(fst_new == function && snd_new == argument)
             return shared_from_this();
-        return std::make_shared<Application>(fst_new, snd_new);
-    }
-    Expression_ptr beta_reduce() const override {
-        /**
-         * invokes a beta reduction:
-         * if function is a lambda, binds second to the bound variable in
-         * function otherwise, passes beta-reduction on to function
-	 * if function can not be reduced further, passes beta-reduction
-	 * to argument (Normal order reduction)
-         */
-        if(Lambda_ptr lbd = std::dynamic_pointer_cast<const Lambda>(function);
-            lbd)
-            return lbd->substitute(lbd->get_head(), argument);
-
-        auto res1 = function->beta_reduce();
-        if(res1 == function) {
-            // no changes, i.e. function is in normal form
-            auto res2 = argument->beta_reduce();
-            if(res2 == argument) return shared_from_this();
-            return std::make_shared<Application>(function,
-                                                 argument->beta_reduce());
-        }
-        return std::make_shared<Application>(res1, argument);
+        return make_node<Application>(fst_new, snd_new, get_origin());
     }
+    Expression_ptr instantiate(Variable_ptr e_old, Expression_ptr e_new,
+                               Renaming& renaming) const;
+    Expression_ptr beta_reduce() const;
     Expression_ptr alpha_convert(const std::string& old_name,
-                                 const std::string& new_name) const override {
+                                 const std::string& new_name) const {
         /**
          * renames bound variable old_name to new_name
          */
@@ -241,38 +396,192 @@ class Application final : public Expression {
         auto res2 = argument->alpha_convert(old_name, new_name);
         if(res1 == function && res2 == argument)
             return shared_from_this();
-        return std::make_shared<Application>(res1, res2);
+        return make_node<Application>(res1, res2, get_origin());
 
     }
-    bool check_for_name_clash(const std::string& new_name) const noexcept
-        override {
+    bool check_for_name_clash(const std::string& new_name) const {
 	/**
 	 * checks if either function or argument contain a avriable with name new_name
 	 */
         return function->check_for_name_clash(new_name) ||
                argument->check_for_name_clash(new_name);
     }
-    Expression_ptr get_function() const noexcept {
+    const Expression_ptr& get_function() const noexcept {
 	/**
 	 * getter for function field
 	 */
         return function;
     }
-    Expression_ptr get_argument() const noexcept {
+    const Expression_ptr& get_argument() const noexcept {
 	/**
 	 * getter for argument field
 	 */
         return argument;
     }
-    std::ostream& print(std::ostream& os) const override {
+    std::ostream& print(std::ostream& os) const {
 	/**
 	 * used for output
 	 */
         return os << "(" << *function << ") " << *argument;
     }
   private:
+    friend class InPlace;
     Expression_ptr function;
     Expression_ptr argument;
 };
 
 
+class Reference final : public Expression {
+    /**
+     * a NAME that stands for the value of its definition, e.g. ID.
+     * The value is computed by the resolver when reduction first needs it,
+     * i.e. when the strategy reaches the reference (see strategy.hpp), and
+     * then cached, so all uses of the node share it. Until then the
+     * reference is a closed leaf: substitution and instantiation keep it.
+     * Printing and alpha conversion see the value.
+     * The command the resolver executes may be given as definition, so that
+     * the reference can be identified by its definition instead of its
+     * name, e.g. by a ResultCache (see result-cache.hpp).
+     */
+  public:
+    static constexpr NodeKind node_kind = NodeKind::reference;
+    typedef std::function<Expression_ptr()> Resolver;
+    Reference(std::string name, Resolver resolver,
+              const Origin* origin = nullptr,
+              std::shared_ptr<const Command> definition = nullptr)
+        : Expression(node_kind, origin), name(std::move(name)),
+          resolver(std::move(resolver)), definition(std::move(definition)),
+          once(), value(), resolved(false) {}
+    const std::string& get_name() const noexcept {
+        return name;
+    }
+    /** @return the command the reference stands for, nullptr if unknown */
+    const std::shared_ptr<const Command>& get_definition() const noexcept {
+        return definition;
+    }
+    /** @return the value, resolved on the first call. Throws what the
+     * resolver throws, e.g. MaxIterationsExceeded, and then tries again on
+     * the next call */
+    const Expression_ptr& get_value() const;
+    /** @return true if the value has been resolved */
+    bool is_resolved() const noexcept {
+        return resolved.load(std::memory_order_acquire);
+    }
+    Expression_ptr beta_reduce() const;
+    Expression_ptr substitute(Variable_ptr e1, Expression_ptr e2) const {
+        /**
+         * the value is closed, so nothing is substituted
+         */
+        return shared_from_this();
+    }
+    Expression_ptr instantiate(Variable_ptr e1, Expression_ptr e2,
+                               Renaming& renaming) const;
+    Expression_ptr alpha_convert(const std::string& old_name,
+                                 const std::string& new_name) const {
+        /**
+         * converts the value, itself if nothing was renamed
+         */
+        const Expression_ptr& v = get_value();
+        auto res = v->alpha_convert(old_name, new_name);
+        if(res == v) return shared_from_this();
+        return res;
+    }
+    bool check_for_name_clash(const std::string& new_name) const {
+        return get_value()->check_for_name_clash(new_name);
+    }
+    std::ostream& print(std::ostream& os) const {
+        return os << *get_value();
+    }
+  private:
+    friend class Compactor;
+    std::string name;
+    // released once the value is resolved
+    mutable Resolver resolver;
+    std::shared_ptr<const Command> definition;
+    mutable std::once_flag once;
+    mutable Expression_ptr value;
+    mutable std::atomic<bool> resolved;
+};
+
+template <typename Visitor>
+decltype(auto) visit(const Expression& ex, Visitor&& visitor) {
+    /**
+     * calls visitor with ex as the Variable, Lambda, Application or
+     * Reference it is. All four calls must return the same type. This is
+     * how passes over terms are written, e.g.
+     *   visit(ex, [](const auto& node) { return node.get_origin(); });
+     * or with one overload per class
+     */
+    switch(ex.get_kind()) {
+        case NodeKind::variable:
+            return visitor(static_cast<const Variable&>(ex));
+        case NodeKind::lambda:
+            return visitor(static_cast<const Lambda&>(ex));
+        case NodeKind::reference:
+            return visitor(static_cast<const Reference&>(ex));
+        case NodeKind::application:
+            break;
+    }
+    return visitor(static_cast<const Application&>(ex));
+}
+
+template <typename T>
+const T* node_cast(const Expression* ex) noexcept {
+    /**
+     * @return ex as T if it is one, else nullptr. Replaces dynamic_cast for
+     * nodes, it only compares the kind
+     */
+    if(ex && ex->get_kind() == T::node_kind) return static_cast<const T*>(ex);
+    return nullptr;
+}
+
+inline const Expression& unfold(const Expression& ex) {
+    /**
+     * @return the value of ex if it is a Reference, else ex itself. Used
+     * where reduction looks at a node in head position
+     */
+    if(auto ref = node_cast<Reference>(&ex); ref) return *ref->get_value();
+    return ex;
+}
+
+inline bool Expression::check_for_name_clash(const std::string& name)
+    const {
+    return visit(*this, [&](const auto& node) {
+        return node.check_for_name_clash(name);
+    });
+}
+
+inline Expression_ptr Expression::beta_reduce() const {
+    return visit(*this, [](const auto& node) {
+        return node.beta_reduce();
+    });
+}
+
+inline Expression_ptr Expression::substitute(Variable_ptr e1,
+                                             Expression_ptr e2) const {
+    return visit(*this, [&](const auto& node) {
+        return node.substitute(e1, e2);
+    });
+}
+
+inline Expression_ptr Expression::instantiate(Variable_ptr e1,
+                                              Expression_ptr e2,
+                                              Renaming& renaming) const {
+    return visit(*this, [&](const auto& node) {
+        return node.instantiate(e1, e2, renaming);
+    });
+}
+
+inline Expression_ptr Expression::alpha_convert(const std::string& old_name,
+                                                const std::string& new_name)
+    const {
+    return visit(*this, [&](const auto& node) {
+        return node.alpha_convert(old_name, new_name);
+    });
+}
+
+inline std::ostream& Expression::print(std::ostream& os) const {
+    return visit(*this, [&](const auto& node) -> std::ostream& {
+        return node.print(os);
+    });
+}
@@ -2,6 +2,9 @@
 #include <algorithm>
 #include <cassert>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include "lambda-exceptions.hpp"
 #include "lambda-struct.hpp"
 #include "tokenizer.hpp"
@@ -18,38 +21,106 @@
  * beta-reduction / alpha conversion commands that then get handled by the
  * Program object.
  * The class Parser defines one method per non-terminal symbol in the grammar.
+ * Parser reads from a std::istream, BufferParser parses a buffer that is
+ * already in memory through a BufferTokenizer (see tokenizer.hpp); both are
+ * instances of the class template BasicParser.
+ * With track_origins(true), e.g. for profiling, every statement is recorded
+ * as a Definition and every node the parser creates points to its Origin in
+ * it (see lambda-struct.hpp). This is off by default, as Definitions are
+ * never freed.
  */
 
+class ScopedBindings {
+    /**
+     * maps variable names to the head variables that bind them.
+     * Every binding is recorded in an undo log, so leaving a lambda restores
+     * the bindings of the enclosing scope in time proportional to the
+     * bindings made inside it instead of copying the whole map.
+     */
+  public:
+    ScopedBindings() : bindings(), log() {}
+    /** @return the variable bound to name or nullptr if there is none */
+    Variable_ptr find(const std::string& name) const {
+        auto it = bindings.find(name);
+        return it == bindings.end() ? nullptr : it->second;
+    }
+    /** binds name to v, shadowing the previous binding */
+    void bind(const std::string& name, Variable_ptr v) {
+        // pointers to elements of an unordered_map stay valid on rehash
+        auto& slot = bindings[name];
+        log.emplace_back(&slot, slot);
+        slot = v;
+    }
+    /** @return a mark for undo, i.e. the current state of the bindings */
+    std::size_t mark() const noexcept {
+        return log.size();
+    }
+    /** restores the bindings to the state when mark was taken */
+    void undo(std::size_t mark) {
+        while(log.size() > mark) {
+            *log.back().first = std::move(log.back().second);
+            log.pop_back();
+        }
+    }
+    void clear() {
+        undo(0);
+    }
+  private:
+    std::unordered_map<std::string, Variable_ptr> bindings;
+    std::vector<std::pair<Variable_ptr*, Variable_ptr>> log;
+};
+
 // recursive descent parser inspired by
 // https://en.wikipedia.org/wiki/Recursive_descent_parser
 // and https://www.geeksforgeeks.org/recursive-descent-parser/
 // adapted to build a syntax tree while parsing
 // I built a LL(1) grammar for this, hence we only need one lookahead
-// (here, this is cur)
-class Parser {
+// (here, this is cur). The recursion of <expression> is replaced by an
+// explicit stack, see BasicParser::expression
+template <typename TokenizerClass = Tokenizer<>>
+class BasicParser {
   public:
     /**
      * in: std::istream to parse from
      * max_iter: maximum iterations at which beta reduction is stopped, 
      * 0 for no limit
      */
-    Parser(std::istream& in, unsigned long max_iter=0)
-            : program(), tz(in), bound(), max_iter(max_iter) {}
+    BasicParser(std::istream& in, unsigned long max_iter=0)
+            : program(), tz(in), frames(), bound(), max_iter(max_iter),
+              deferred(false), placeholders(), tracking(false),
+              source_name(), source_offset(0), prev_end(0),
+              definition(nullptr) {}
+    /**
+     * in: buffer to parse from, must outlive the parser
+     * max_iter: see above
+     */
+    BasicParser(std::string_view in, unsigned long max_iter=0)
+            : program(), tz(in), frames(), bound(), max_iter(max_iter),
+              deferred(false), placeholders(), tracking(false),
+              source_name(), source_offset(0), prev_end(0),
+              definition(nullptr) {}
     Program statement() {
 	/**
 	 * tries to parse one statement from the input stream
-	 * returns program-object on sucess
+	 * returns program-object on sucess, an empty program if there was no
+	 * statement (end of input or a reserved symbol)
 	 */
-        cur = tz.get();
-        if(!cur) return program;
+        advance();
+        if(!cur) return Program();
+        // drop bindings left over from a statement that failed to parse
+        bound.clear();
+        definition = nullptr;
         if(cur.tok == TokenType::name_define) {
             program[Program::last_key] = assignment();
         }
         else {
+            if(tracking)
+                definition = &Definition::create("", source_name, span());
             program[Program::last_key] = rvalue();
         }
         if(cur.tok != TokenType::separator)
             throw SyntaxException("Missing semicolon");
+        if(definition) definition->set_end(source_offset + cur.offset + 1);
         //next_token();
         return program;
     }
@@ -68,24 +139,82 @@ class Parser {
 	 */
         tz.unregister_symbol(symbol);
     }
+    void defer_names(bool defer) noexcept {
+	/**
+	 * if defer is true, NAMEs are no longer looked up in program while
+	 * parsing. Instead, each NAME is parsed as a placeholder variable
+	 * (one per distinct name) that is listed in unresolved() and has to be
+	 * substituted by the caller. This allows statements to be parsed
+	 * without the definitions they refer to, see script-loader.hpp
+	 */
+        deferred = defer;
+    }
+    void track_origins(bool track) noexcept {
+	/**
+	 * if track is true, statements are recorded as Definitions and nodes
+	 * are created with their Origin, which the profiler attributes cost
+	 * to. Off by default, since the Definitions are kept until exit
+	 */
+        tracking = track;
+    }
+    void set_source(std::string name, std::size_t offset = 0,
+                    std::uint32_t line = 1, std::uint32_t column = 1) {
+	/**
+	 * sets the name of the input (e.g. a file name) and the position of
+	 * its next character within it, for the Origins of the nodes
+	 */
+        source_name = std::move(name);
+        source_offset = offset;
+        tz.set_position(line, column);
+    }
+    const std::vector<std::pair<std::string, Variable_ptr>>&
+    unresolved() const noexcept {
+	/**
+	 * placeholders created for deferred NAMEs since the last call to
+	 * clear_unresolved
+	 */
+        return placeholders;
+    }
+    void clear_unresolved() noexcept {
+        placeholders.clear();
+    }
     Program program;
   private:
+    void advance() {
+        prev_end = cur.offset + cur.str.size();
+        cur = tz.get();
+    }
+    SourceSpan span() const noexcept {
+        // span of the current token
+        return {source_offset + cur.offset,
+                source_offset + cur.offset + cur.str.size(), cur.line,
+                cur.column};
+    }
+    const Origin* locate(SourceSpan s) {
+        // origin of a node that spans from s to the last token
+        if(!definition) return nullptr;
+        s.end = std::max(s.end, source_offset + prev_end);
+        return definition->locate(s);
+    }
     Command assignment() {
         assert(cur.tok == TokenType::name_define);
-        cur = tz.get();
+        auto start = span();
+        advance();
         if(cur.tok != TokenType::name)
             throw SyntaxException("Only variables starting with an "
                                   "uppercase letter may be assigned to");
-        auto name = cur.str;
-        cur = tz.get();
+        std::string name(cur.str);
+        if(tracking)
+            definition = &Definition::create(name, source_name, start);
+        advance();
         if(cur.tok != TokenType::name_define)
             throw SyntaxException("Unclosed definition");
 
-        cur = tz.get();
+        advance();
         if(cur.tok != TokenType::assignment)
             throw SyntaxException("defined symbol must be assigned to");
 
-        cur = tz.get();
+        advance();
         Command e = rvalue();
         program[name] = e;
         return e;
@@ -96,63 +225,106 @@ class Parser {
         return Command(e, c);
     }
     Expression_ptr expression() {
-        if(cur.tok == TokenType::lambda) {
-            // backup the bound-map, because there could already be a variable
-            // with the same name as the new head
-            std::unordered_map<std::string, Variable_ptr> backup_bound = bound;
-            cur = tz.get();
-            if(cur.tok != TokenType::identifier) throw SyntaxException();
-            // build head variable
-            Variable_ptr head = std::make_shared<Variable>(cur.str, true);
-            bound[cur.str] = head;
-            cur = tz.get();
-            if(cur.tok != TokenType::body_start)
-                throw SyntaxException("Malformed lambda");
-            cur = tz.get();
-            Expression_ptr body = expression();
-            bound = backup_bound;
-            return std::make_shared<Lambda>(head, body);
-        }
-        else if(cur.tok == TokenType::bracket_open) {
-            cur = tz.get();
-            Expression_ptr fst;
-            fst = expression();
-            if(cur.tok != TokenType::bracket_close)
-                throw SyntaxException("unmatched bracket");
-            cur = tz.get();
-            auto snd = expression();
-            return std::make_shared<Application>(fst, snd);
+        /**
+         * <expression> is the only recursive non-terminal of the grammar.
+         * Instead of recursing, lambdas and applications whose
+         * sub-expressions are still being parsed are kept as frames on an
+         * explicit stack, so the nesting depth of the input is only limited
+         * by memory. Each iteration of the outer loop parses the prefix of
+         * one <expression> down to its first atom, the inner loop then
+         * completes all frames that are finished by this atom.
+         */
+        frames.clear();
+        while(true) {
+            if(cur.tok == TokenType::lambda) {
+                auto start = span();
+                advance();
+                if(cur.tok != TokenType::identifier) throw SyntaxException();
+                // build head variable, it shadows variables of the same
+                // name until the frame is completed
+                std::string head_name(cur.str);
+                Variable_ptr head = make_node<Variable>(
+                    head_name, true, locate(span()));
+                auto mark = bound.mark();
+                bound.bind(head_name, head);
+                advance();
+                if(cur.tok != TokenType::body_start)
+                    throw SyntaxException("Malformed lambda");
+                advance();
+                frames.push_back({Frame::lambda_body, head, nullptr, mark,
+                                  start});
+                continue;
+            }
+            else if(cur.tok == TokenType::bracket_open) {
+                frames.push_back({Frame::function_part, nullptr, nullptr, 0,
+                                  span()});
+                advance();
+                continue;
+            }
+            Expression_ptr result = atom();
+            while(!frames.empty()) {
+                Frame& f = frames.back();
+                if(f.kind == Frame::lambda_body) {
+                    result = make_node<Lambda>(f.head, result, locate(f.start));
+                    bound.undo(f.mark);
+                }
+                else if(f.kind == Frame::argument_part) {
+                    result = make_node<Application>(
+                        f.function, result, locate(f.start));
+                }
+                else {
+                    if(cur.tok != TokenType::bracket_close)
+                        throw SyntaxException("unmatched bracket");
+                    advance();
+                    // the argument is the next <expression>
+                    f.kind = Frame::argument_part;
+                    f.function = result;
+                    break;
+                }
+                frames.pop_back();
+            }
+            if(frames.empty()) return result;
         }
-        else if(cur.tok == TokenType::identifier) {
-            if(auto v = bound.find(cur.str); v != bound.end()) {
-                cur = tz.get();
-                return v->second;
+    }
+    Expression_ptr atom() {
+        if(cur.tok == TokenType::identifier) {
+            std::string name(cur.str);
+            if(auto v = bound.find(name); v) {
+                advance();
+                return v;
             }
-            auto name = cur.str;
-            cur = tz.get();
-            return std::make_shared<Variable>(name, false);
+            auto start = span();
+            advance();
+            return make_node<Variable>(name, false, locate(start));
         }
         else if(cur.tok == TokenType::literal) {
             try {
-                auto num = stoi(cur.str);
-                cur = tz.get();
+                auto num = stoi(std::string(cur.str));
+                advance();
                 return church_encode(num);
             } catch(std::invalid_argument&) {
                 // literal was boolean
-                auto val = cur.str;
-                cur = tz.get();
+                std::string val(cur.str);
+                advance();
                 if(val == "true") return church_true();
                 else return church_false();
             }
         }
         else if(cur.tok == TokenType::name) {
-            auto name = cur.str;
-            cur = tz.get();
-            if(!program.contains(name))
-                throw SyntaxException("Undefined symbol: " + name);
-            return program[name].execute();
+            std::string name(cur.str);
+            advance();
+            if(deferred) {
+                for(const auto& p: placeholders)
+                    if(p.first == name) return p.second;
+                auto v = make_node<Variable>(name, false);
+                placeholders.emplace_back(name, v);
+                return v;
+            }
+            // resolved only if reduction needs the value
+            return program.reference(name);
         }
-        else throw SyntaxException("unexpected token: " + cur.str);
+        else throw SyntaxException("unexpected token: "
+                                   + std::string(cur.str));
     }
     std::shared_ptr<Conversion> conversion() {
         if(cur.tok == TokenType::literal || cur.tok == TokenType::conv_end)
@@ -169,7 +341,7 @@ class Parser {
         for(auto t: tokens) {
             if(cur.tok != t) throw SyntaxException();
             if(cur.tok == TokenType::identifier) names[i++] = cur.str;
-            cur = tz.get();
+            advance();
         }
         return std::make_shared<AlphaConversion>(names[0], names[1]);
     }
@@ -187,25 +359,60 @@ class Parser {
                 // as "literal", this should never fail.
                 // However, for unexpected use cases this assertion is here
                 assert(std::all_of(cur.str.begin(), cur.str.end(), ::isdigit));
-                iters = std::stol(cur.str);
+                iters = std::stol(std::string(cur.str));
             }
-            cur = tz.get();
+            advance();
             if(cur.tok != TokenType::conv_end)
                 throw SyntaxException("Malformed beta reduction");
-            cur = tz.get();
+            advance();
             return std::make_shared<BetaReduction>(
                     iters > max_iter && max_iter != 0 ? max_iter : iters,
-                    max_iter
+                    max_iter, strategy()
                     );
         }
         else {
-            cur = tz.get();
-            return std::make_shared<BetaReduction>(max_iter, max_iter);
+            advance();
+            return std::make_shared<BetaReduction>(max_iter, max_iter,
+                                                   strategy());
         }
     }
+    Strategy strategy() {
+        /**
+         * optional name of the reduction strategy after ">"
+         */
+        if(cur.tok != TokenType::identifier) return Strategy::normal;
+        Strategy s = parse_strategy(std::string(cur.str));
+        advance();
+        return s;
+    }
     //lookahead
-    Token cur;
-    Tokenizer<> tz;
-    std::unordered_map<std::string, Variable_ptr> bound;
+    typename TokenizerClass::token_type cur;
+    TokenizerClass tz;
+    struct Frame {
+        /**
+         * a lambda waiting for its body, or an application waiting for
+         * its function or its argument
+         */
+        enum {lambda_body, function_part, argument_part} kind;
+        Variable_ptr head;
+        Expression_ptr function;
+        std::size_t mark;
+        // span of the first token of the lambda or application
+        SourceSpan start;
+    };
+    std::vector<Frame> frames;
+    ScopedBindings bound;
     unsigned long max_iter;
+    bool deferred;
+    std::vector<std::pair<std::string, Variable_ptr>> placeholders;
+    bool tracking;
+    std::string source_name;
+    // offset of the input within the source, and end of the last token
+    std::size_t source_offset;
+    std::size_t prev_end;
+    // definition of the current statement, nullptr if not tracking
+    Definition* definition;
 };
+
+typedef BasicParser<> Parser;
+typedef BasicParser<BufferTokenizer<>> BufferParser;
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include "node-allocator.hpp"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/**
+ * ABSTRACT:
+ * Implementation of node-allocator.hpp
+ */
+
+namespace {
+
+constexpr std::size_t classes = NodePool::max_size / NodePool::granularity;
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+struct Orphans {
+    /**
+     * free blocks of threads that have exited, per size class
+     */
+    std::mutex mutex;
+    FreeBlock* free[classes] = {};
+};
+
+Orphans& orphans() {
+    // never destroyed, threads may exit after static destruction started
+    static Orphans* instance = new Orphans();
+    return *instance;
+}
+
+struct Slab {
+    /**
+     * a slab of blocks of one size class
+     */
+    std::size_t block_size;
+    // scratch counter of release_free_slabs
+    std::size_t free_blocks;
+};
+
+struct Slabs {
+    /**
+     * all slabs, by address, so that the slab of a block can be found
+     */
+    std::mutex mutex;
+    std::map<const char*, Slab> by_address;
+    std::atomic<std::size_t> bytes{0};
+};
+
+Slabs& slabs() {
+    // never destroyed, like the orphans
+    static Slabs* instance = new Slabs();
+    return *instance;
+}
+
+FreeBlock*& last_link(FreeBlock*& list) noexcept {
+    FreeBlock** link = &list;
+    while(*link) link = &(*link)->next;
+    return *link;
+}
+
+struct ThreadPool {
+    /**
+     * free lists and counters of one thread. Trivially destructible, so it
+     * stays usable while the objects of an exiting thread are destroyed.
+     */
+    FreeBlock* free[classes];
+    // the free lists from before the current NodePool::Relocation
+    FreeBlock* parked[classes];
+    unsigned relocations;
+    MemoryStats stats;
+    // set when the thread exits. Blocks freed after that, e.g. by static
+    // destructors of the main thread, are not handed over anymore
+    bool retired;
+
+    FreeBlock* refill(std::size_t c);
+
+    void count_allocation(std::size_t size) noexcept {
+        ++stats.allocations;
+        stats.bytes_allocated += size;
+        stats.live_bytes += size;
+        stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+    }
+
+    void count_deallocation(std::size_t size) noexcept {
+        ++stats.deallocations;
+        stats.bytes_freed += size;
+        stats.live_bytes -= size;
+    }
+};
+
+thread_local ThreadPool pool{};
+
+struct Retirement {
+    /**
+     * hands the free lists of pool over to the orphans when the thread exits
+     */
+    ~Retirement() {
+        NodePool::hand_over();
+        pool.retired = true;
+    }
+};
+
+FreeBlock* ThreadPool::refill(std::size_t c) {
+    /**
+     * adopts the orphaned blocks of class c or carves a new slab. During a
+     * Relocation, only new slabs will do
+     */
+    if(!retired) {
+        // constructed on first use, so only threads that allocate nodes
+        // pay for it
+        thread_local Retirement retirement;
+        (void) retirement;
+    }
+    if(!relocations) {
+        Orphans& o = orphans();
+        std::lock_guard<std::mutex> lock(o.mutex);
+        if(o.free[c]) {
+            FreeBlock* blocks = o.free[c];
+            o.free[c] = nullptr;
+            return blocks;
+        }
+    }
+    std::size_t size = (c + 1) * NodePool::granularity;
+    std::size_t count = NodePool::slab_size / size;
+    char* slab = static_cast<char*>(::operator new(count * size));
+    {
+        Slabs& s = slabs();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.by_address.emplace(slab, Slab{size, 0});
+        s.bytes.fetch_add(count * size, std::memory_order_relaxed);
+    }
+    FreeBlock* blocks = nullptr;
+    for(std::size_t i = count; i-- > 0;) {
+        auto block = reinterpret_cast<FreeBlock*>(slab + i * size);
+        block->next = blocks;
+        blocks = block;
+    }
+    return blocks;
+}
+
+std::size_t size_class(std::size_t size) noexcept {
+    return (size + NodePool::granularity - 1) / NodePool::granularity - 1;
+}
+
+}
+
+void* NodePool::allocate(std::size_t size) {
+    pool.count_allocation(size);
+    if(size > max_size) return ::operator new(size);
+    std::size_t c = size_class(size);
+    FreeBlock* block = pool.free[c];
+    if(!block) block = pool.refill(c);
+    pool.free[c] = block->next;
+    return block;
+}
+
+void NodePool::deallocate(void* p, std::size_t size) noexcept {
+    pool.count_deallocation(size);
+    if(size > max_size) {
+        ::operator delete(p);
+        return;
+    }
+    std::size_t c = size_class(size);
+    auto block = static_cast<FreeBlock*>(p);
+    block->next = pool.free[c];
+    pool.free[c] = block;
+}
+
+void NodePool::hand_over() noexcept {
+    Orphans& o = orphans();
+    std::lock_guard<std::mutex> lock(o.mutex);
+    for(std::size_t c = 0; c < classes; ++c) {
+        if(!pool.free[c]) continue;
+        last_link(pool.free[c]) = o.free[c];
+        o.free[c] = pool.free[c];
+        pool.free[c] = nullptr;
+    }
+}
+
+NodePool::Relocation::Relocation() noexcept {
+    if(pool.relocations++) return;
+    for(std::size_t c = 0; c < classes; ++c) {
+        pool.parked[c] = pool.free[c];
+        pool.free[c] = nullptr;
+    }
+}
+
+NodePool::Relocation::~Relocation() {
+    /**
+     * the rest of the new slabs comes first, so that nodes created next
+     * are close to the relocated ones
+     */
+    if(--pool.relocations) return;
+    for(std::size_t c = 0; c < classes; ++c) {
+        last_link(pool.free[c]) = pool.parked[c];
+        pool.parked[c] = nullptr;
+    }
+}
+
+std::size_t NodePool::release_free_slabs() {
+    /**
+     * counts the free blocks of every slab, unlinks the blocks of slabs
+     * that are entirely free and deletes these slabs. Blocks on the free
+     * lists of other running threads are not seen, so their slabs stay
+     */
+    Orphans& o = orphans();
+    Slabs& s = slabs();
+    std::lock_guard<std::mutex> orphans_lock(o.mutex);
+    std::lock_guard<std::mutex> slabs_lock(s.mutex);
+    auto slab_of = [&s](FreeBlock* block) {
+        auto it = s.by_address.upper_bound(reinterpret_cast<char*>(block));
+        return --it;
+    };
+    auto is_empty = [](const Slab& slab) {
+        return slab.free_blocks == slab_size / slab.block_size;
+    };
+    for(std::size_t c = 0; c < classes; ++c)
+        for(FreeBlock* list: {pool.free[c], o.free[c]})
+            for(FreeBlock* b = list; b; b = b->next)
+                ++slab_of(b)->second.free_blocks;
+    for(std::size_t c = 0; c < classes; ++c) {
+        for(FreeBlock** list: {&pool.free[c], &o.free[c]}) {
+            FreeBlock** link = list;
+            while(*link) {
+                if(is_empty(slab_of(*link)->second)) *link = (*link)->next;
+                else link = &(*link)->next;
+            }
+        }
+    }
+    std::size_t released = 0;
+    for(auto it = s.by_address.begin(); it != s.by_address.end();) {
+        if(!is_empty(it->second)) {
+            it->second.free_blocks = 0;
+            ++it;
+            continue;
+        }
+        released += slab_size / it->second.block_size
+                    * it->second.block_size;
+        ::operator delete(const_cast<char*>(it->first));
+        it = s.by_address.erase(it);
+    }
+    s.bytes.fetch_sub(released, std::memory_order_relaxed);
+#ifdef __GLIBC__
+    // slabs are smaller than the mmap threshold, glibc keeps them in its
+    // heap unless asked to give free pages back
+    if(released) malloc_trim(0);
+#endif
+    return released;
+}
+
+std::size_t NodePool::slab_bytes() noexcept {
+    return slabs().bytes.load(std::memory_order_relaxed);
+}
+
+const MemoryStats& node_memory() noexcept {
+    return pool.stats;
+}
+
+void reset_peak_node_memory() noexcept {
+    pool.stats.peak_bytes = pool.stats.live_bytes;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * ABSTRACT:
+ * This header contains the allocator for the nodes of lambda expressions
+ * (see lambda-struct.hpp). Expression overloads operator new and delete, so
+ * every node (including its intrusive reference count, see ref.hpp) is one
+ * block from a pool instead of a request to the general-purpose allocator.
+ * There is one pool per size class (multiples of 16 bytes up to
+ * NodePool::max_size), each a free list of blocks carved from larger slabs.
+ * Free lists are thread-local, so allocating and freeing never locks; a block
+ * freed on another thread than the one that allocated it simply moves to the
+ * free list of that thread. When a thread exits, its free blocks are handed
+ * over to the next thread that runs out of blocks. Slabs go back to the
+ * system only when NodePool::release_free_slabs finds all their blocks free,
+ * which is what a Compactor (see compactor.hpp) arranges by relocating the
+ * live nodes into new slabs (see NodePool::Relocation).
+ * Every thread counts the node memory it allocates and frees, see
+ * node_memory. CollectStats (see reduction.hpp) uses these counters to report
+ * the memory of an evaluation.
+ * Compiling with LAMBDA_NO_NODE_POOL leaves nodes to the global operator new,
+ * the counters then stay at zero.
+ */
+
+struct MemoryStats {
+    /**
+     * node memory allocated and freed by one thread
+     */
+    unsigned long allocations = 0;
+    unsigned long deallocations = 0;
+    std::size_t bytes_allocated = 0;
+    std::size_t bytes_freed = 0;
+    // bytes_allocated - bytes_freed, negative if the thread freed more nodes
+    // than it allocated, e.g. nodes of a parser thread
+    std::ptrdiff_t live_bytes = 0;
+    // maximum of live_bytes since the thread started or reset_peak
+    std::ptrdiff_t peak_bytes = 0;
+};
+
+class NodePool {
+    /**
+     * the pools of all size classes
+     */
+  public:
+    // requests larger than this go to operator new
+    static constexpr std::size_t max_size = 256;
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t slab_size = 64 * 1024;
+    /** @return block of at least size bytes, aligned to granularity */
+    static void* allocate(std::size_t size);
+    /** @param size as passed to allocate */
+    static void deallocate(void* p, std::size_t size) noexcept;
+    /** hands the free blocks of the calling thread over to the next threads
+     * that run out of blocks, e.g. after freeing nodes of other threads */
+    static void hand_over() noexcept;
+
+    class Relocation {
+        /**
+         * while it exists, the calling thread allocates from new slabs
+         * only, so the nodes it creates are contiguous and the blocks that
+         * were free before do not pin old slabs. Afterwards the old free
+         * blocks are usable again
+         */
+      public:
+        Relocation() noexcept;
+        ~Relocation();
+        Relocation(const Relocation&) = delete;
+        Relocation& operator=(const Relocation&) = delete;
+    };
+
+    /**
+     * returns the slabs all of whose blocks are on the free lists of the
+     * calling thread or of exited threads to the system
+     * @return number of bytes released
+     */
+    static std::size_t release_free_slabs();
+
+    /** @return bytes of all slabs currently held by the pools */
+    static std::size_t slab_bytes() noexcept;
+};
+
+/** @return counters of the calling thread */
+const MemoryStats& node_memory() noexcept;
+
+/** sets peak_bytes of the calling thread to its current live_bytes */
+void reset_peak_node_memory() noexcept;
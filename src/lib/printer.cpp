@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include "printer.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of printer.hpp
+ */
+
+namespace {
+
+const std::string_view elision = "...";
+
+std::size_t saturating_add(std::size_t a, std::size_t b) {
+    if(a > std::numeric_limits<std::size_t>::max() - b)
+        return std::numeric_limits<std::size_t>::max();
+    return a + b;
+}
+
+}
+
+void Printer::put(std::string_view s) {
+    if(truncated) return;
+    if(options.max_bytes && sink.written() + s.size() > options.max_bytes) {
+        // write as much as fits, then mark the rest as elided
+        sink.put(s.substr(0, options.max_bytes - sink.written()));
+        sink.put(elision);
+        truncated = true;
+        return;
+    }
+    sink.put(s);
+}
+
+std::string Printer::fragment_name(std::size_t i) const {
+    // NAMEs may only contain letters, so fragments are numbered in base 26
+    std::string digits;
+    do {
+        digits += static_cast<char>('A' + i % 26);
+        i /= 26;
+    } while(i > 0);
+    return options.fragment_prefix +
+        std::string(digits.rbegin(), digits.rend());
+}
+
+void Printer::find_fragments(const Expression& root) {
+    /**
+     * counts the parents of every node and computes size and free bound
+     * variables bottom-up. A node becomes a fragment iff it has more than
+     * one parent, is large enough and closed, i.e. does not depend on the
+     * lambdas around it. Fragments are collected in post-order, so every
+     * fragment only refers to fragments that are written before it.
+     */
+    std::vector<std::pair<const Expression*, bool>> stack;
+    stack.emplace_back(&root, false);
+    info[&root];
+    while(!stack.empty()) {
+        auto [ex, expanded] = stack.back();
+        stack.pop_back();
+        if(!expanded) {
+            stack.emplace_back(ex, true);
+            auto visit = [&](const Expression* child) {
+                child = &unfold(*child);
+                auto [it, inserted] = info.try_emplace(child);
+                ++it->second.parents;
+                if(inserted) stack.emplace_back(child, false);
+            };
+            if(auto lbd = node_cast<Lambda>(ex); lbd)
+                visit(lbd->get_body().get());
+            else if(auto app = node_cast<Application>(ex); app) {
+                visit(app->get_argument().get());
+                visit(app->get_function().get());
+            }
+            continue;
+        }
+        NodeInfo& node = info[ex];
+        if(auto var = node_cast<Variable>(ex); var) {
+            node.size = 1;
+            if(var->is_bound()) node.free_bound.push_back(var);
+            continue;
+        }
+        if(auto lbd = node_cast<Lambda>(ex); lbd) {
+            const NodeInfo& body = info[lbd->get_body().get()];
+            node.size = saturating_add(body.size, 1);
+            const Variable* head = lbd->get_head().get();
+            std::copy_if(body.free_bound.begin(), body.free_bound.end(),
+                         std::back_inserter(node.free_bound),
+                         [head](const Variable* v) { return v != head; });
+        }
+        else {
+            auto app = static_cast<const Application*>(ex);
+            const NodeInfo& fn = info[app->get_function().get()];
+            const NodeInfo& arg = info[app->get_argument().get()];
+            node.size = saturating_add(saturating_add(fn.size, arg.size), 1);
+            std::set_union(fn.free_bound.begin(), fn.free_bound.end(),
+                           arg.free_bound.begin(), arg.free_bound.end(),
+                           std::back_inserter(node.free_bound));
+        }
+        if(node.parents > 1 && node.size >= options.min_fragment_size &&
+           node.free_bound.empty()) {
+            node.fragment = fragments.size();
+            fragments.push_back(ex);
+        }
+    }
+}
+
+void Printer::print_term(const Expression& root, bool fragment_root) {
+    /**
+     * writes root in the notation of Expression::print. Pending work is
+     * kept on an explicit stack: either a node with its depth or a piece
+     * of text that has to be written after the nodes above it.
+     */
+    struct Task {
+        const Expression* ex;
+        std::string_view text;
+        std::size_t depth;
+    };
+    std::vector<Task> stack;
+    stack.push_back({&root, {}, 1});
+    while(!stack.empty() && !truncated) {
+        Task task = stack.back();
+        stack.pop_back();
+        if(!task.ex) {
+            put(task.text);
+            continue;
+        }
+        const Expression* ex = &unfold(*task.ex);
+        if(options.share && !(fragment_root && ex == &root)) {
+            if(auto it = info.find(ex);
+               it != info.end() && it->second.fragment >= 0) {
+                put(fragment_name(it->second.fragment));
+                continue;
+            }
+        }
+        if(options.max_depth && task.depth > options.max_depth) {
+            put(elision);
+            continue;
+        }
+        if(auto var = node_cast<Variable>(ex); var) {
+            put(var->get_name());
+        }
+        else if(auto lbd = node_cast<Lambda>(ex); lbd) {
+            put("\\");
+            put(lbd->get_head()->get_name());
+            put(" . ");
+            stack.push_back({lbd->get_body().get(), {}, task.depth + 1});
+        }
+        else {
+            auto app = static_cast<const Application*>(ex);
+            put("(");
+            stack.push_back({app->get_argument().get(), {}, task.depth + 1});
+            stack.push_back({nullptr, ") ", 0});
+            stack.push_back({app->get_function().get(), {}, task.depth + 1});
+        }
+    }
+}
+
+void Printer::print(const Expression& term) {
+    // references are printed as their value
+    const Expression& ex = unfold(term);
+    info.clear();
+    fragments.clear();
+    if(options.share) {
+        find_fragments(ex);
+        for(std::size_t i = 0; i < fragments.size() && !truncated; ++i) {
+            put("'");
+            put(fragment_name(i));
+            put("' = ");
+            print_term(*fragments[i], true);
+            put(";\n");
+        }
+    }
+    print_term(ex, true);
+    sink.flush();
+}
+
+void print_expression(std::ostream& os, const Expression& ex,
+                      const PrintOptions& options) {
+    Printer(os, options).print(ex);
+}
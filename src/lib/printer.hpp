@@ -0,0 +1,105 @@
+#pragma once
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "lambda-struct.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the class Printer, which writes Expressions in the
+ * same notation as Expression::print, but iteratively (so the depth of a
+ * term is not limited by the call stack) and through a buffered OutputSink
+ * instead of one std::ostream call per token.
+ * Optionally, the Printer
+ *   - writes subterms that occur more than once only once, as named
+ *     fragments in assignment syntax ('FA' = ...;) in front of the term,
+ *     so the output can be parsed again,
+ *   - stops after a number of bytes or below a nesting depth and marks
+ *     the elided parts with "...".
+ */
+
+class OutputSink {
+    /**
+     * collects characters in a buffer and writes them to a std::ostream
+     * in blocks
+     */
+  public:
+    explicit OutputSink(std::ostream& os, std::size_t capacity = 1 << 14)
+        : os(os), capacity(capacity), buffer(), count(0) {}
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+    ~OutputSink() {
+        flush();
+    }
+    void put(std::string_view s) {
+        if(buffer.size() + s.size() > capacity) flush();
+        if(s.size() > capacity) os.write(s.data(), s.size());
+        else buffer.append(s);
+        count += s.size();
+    }
+    void flush() {
+        os.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    /** @return number of bytes written so far */
+    std::size_t written() const noexcept {
+        return count;
+    }
+  private:
+    std::ostream& os;
+    std::size_t capacity;
+    std::string buffer;
+    std::size_t count;
+};
+
+struct PrintOptions {
+    /** write shared subterms once as named fragments */
+    bool share = false;
+    /** minimum number of nodes of a shared subterm to become a fragment */
+    std::size_t min_fragment_size = 8;
+    /** prefix of fragment names, has to be an uppercase word */
+    std::string fragment_prefix = "F";
+    /** maximum number of bytes to write, 0 for no limit */
+    std::size_t max_bytes = 0;
+    /** maximum nesting depth to write, 0 for no limit */
+    std::size_t max_depth = 0;
+};
+
+class Printer {
+  public:
+    explicit Printer(std::ostream& os, PrintOptions options = PrintOptions())
+        : sink(os), options(options), truncated(false), info(),
+          fragments() {}
+    /** writes ex according to the options */
+    void print(const Expression& ex);
+    /** @return true iff output was elided because of max_bytes */
+    bool was_truncated() const noexcept {
+        return truncated;
+    }
+  private:
+    struct NodeInfo {
+        // number of parents in the term
+        std::size_t parents = 0;
+        // number of nodes if the term was a tree, saturated
+        std::size_t size = 0;
+        // bound variables that occur free in the subterm, sorted
+        std::vector<const Variable*> free_bound;
+        // index of the fragment, -1 if the node is written inline
+        long fragment = -1;
+    };
+    void find_fragments(const Expression& root);
+    void print_term(const Expression& root, bool fragment_root);
+    void put(std::string_view s);
+    std::string fragment_name(std::size_t i) const;
+    OutputSink sink;
+    PrintOptions options;
+    bool truncated;
+    std::unordered_map<const Expression*, NodeInfo> info;
+    std::vector<const Expression*> fragments;
+};
+
+/** writes ex to os, see Printer */
+void print_expression(std::ostream& os, const Expression& ex,
+                      const PrintOptions& options = PrintOptions());
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include "profiler.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of profiler.hpp
+ */
+
+namespace {
+
+std::string json_string(const std::string& str) {
+    std::string out = "\"";
+    for(char c: str) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+double microseconds(std::chrono::nanoseconds ns) {
+    return ns.count() / 1000.0;
+}
+
+void replay(const std::vector<Profile::Sample>& samples,
+            const std::function<void(std::size_t, std::chrono::nanoseconds)>&
+                open,
+            const std::function<void(std::size_t, std::chrono::nanoseconds)>&
+                close) {
+    /**
+     * turns the samples into properly nested open and close events of
+     * their frames, merging frames that consecutive samples have in common
+     */
+    std::vector<std::size_t> stack;
+    std::chrono::nanoseconds now{0};
+    for(const auto& sample: samples) {
+        std::size_t common = 0;
+        while(common < stack.size() && common < sample.stack.size() &&
+              stack[common] == sample.stack[common])
+            ++common;
+        while(stack.size() > common) {
+            close(stack.back(), sample.start);
+            stack.pop_back();
+        }
+        for(std::size_t i = common; i < sample.stack.size(); ++i) {
+            open(sample.stack[i], sample.start);
+            stack.push_back(sample.stack[i]);
+        }
+        now = sample.start + sample.duration;
+    }
+    while(!stack.empty()) {
+        close(stack.back(), now);
+        stack.pop_back();
+    }
+}
+
+}
+
+std::size_t Profile::frame(const Definition* definition) {
+    auto [it, inserted] = frame_index.try_emplace(definition, frames.size());
+    if(inserted) {
+        if(!definition) frames.push_back({"<unknown>", "", 0});
+        else frames.push_back({definition->get_name().empty() ?
+                                   "<expression>" : definition->get_name(),
+                               definition->get_source(),
+                               definition->get_span().line});
+    }
+    return it->second;
+}
+
+std::vector<Profile::Cost> Profile::by_definition() const {
+    std::vector<Cost> costs(frames.size());
+    for(std::size_t i = 0; i < frames.size(); ++i) {
+        costs[i].name = frames[i].name;
+        costs[i].source = frames[i].source;
+        costs[i].line = frames[i].line;
+    }
+    for(const auto& sample: samples) {
+        Cost& cost = costs[sample.stack.back()];
+        ++cost.steps;
+        cost.substitutions += sample.substitutions;
+        cost.time += sample.duration;
+    }
+    costs.erase(std::remove_if(costs.begin(), costs.end(),
+                               [](const Cost& c) { return c.steps == 0; }),
+                costs.end());
+    std::stable_sort(costs.begin(), costs.end(),
+                     [](const Cost& a, const Cost& b) {
+                         if(a.time != b.time) return a.time > b.time;
+                         return a.steps > b.steps;
+                     });
+    return costs;
+}
+
+void Profile::write_chrome_trace(std::ostream& os) const {
+    std::vector<std::chrono::nanoseconds> opened(frames.size());
+    bool first = true;
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    replay(samples,
+           [&](std::size_t f, std::chrono::nanoseconds at) {
+               opened[f] = at;
+           },
+           [&](std::size_t f, std::chrono::nanoseconds at) {
+               if(!first) os << ",";
+               first = false;
+               os << "\n{\"name\":" << json_string(frames[f].name)
+                  << ",\"cat\":\"reduction\",\"ph\":\"X\",\"pid\":1,"
+                     "\"tid\":1,\"ts\":" << microseconds(opened[f])
+                  << ",\"dur\":" << microseconds(at - opened[f])
+                  << ",\"args\":{\"source\":"
+                  << json_string(frames[f].source) << ",\"line\":"
+                  << frames[f].line << "}}";
+           });
+    os << "\n]}\n";
+}
+
+void Profile::write_speedscope(std::ostream& os) const {
+    os << "{\"$schema\":\"https://www.speedscope.app/file-format-schema.json\","
+          "\"exporter\":\"lambda\",\"name\":\"reduction\","
+          "\"shared\":{\"frames\":[";
+    for(std::size_t i = 0; i < frames.size(); ++i) {
+        if(i) os << ",";
+        os << "\n{\"name\":" << json_string(frames[i].name);
+        if(!frames[i].source.empty())
+            os << ",\"file\":" << json_string(frames[i].source);
+        if(frames[i].line) os << ",\"line\":" << frames[i].line;
+        os << "}";
+    }
+    auto end = samples.empty() ? std::chrono::nanoseconds(0) :
+        samples.back().start + samples.back().duration;
+    os << "]},\"profiles\":[{\"type\":\"evented\",\"name\":\"reduction\","
+          "\"unit\":\"nanoseconds\",\"startValue\":0,\"endValue\":"
+       << end.count() << ",\"events\":[";
+    bool first = true;
+    auto event = [&](const char* type, std::size_t f,
+                     std::chrono::nanoseconds at) {
+        if(!first) os << ",";
+        first = false;
+        os << "\n{\"type\":\"" << type << "\",\"frame\":" << f
+           << ",\"at\":" << at.count() << "}";
+    };
+    replay(samples,
+           [&](std::size_t f, std::chrono::nanoseconds at) {
+               event("O", f, at);
+           },
+           [&](std::size_t f, std::chrono::nanoseconds at) {
+               event("C", f, at);
+           });
+    os << "\n]}]}\n";
+}
+
+void Profile::write_folded(std::ostream& os) const {
+    std::map<std::string, unsigned long> stacks;
+    for(const auto& sample: samples) {
+        std::string line;
+        for(std::size_t f: sample.stack) {
+            if(!line.empty()) line += ';';
+            line += frames[f].name;
+        }
+        ++stacks[line];
+    }
+    for(const auto& [stack, steps]: stacks)
+        os << stack << " " << steps << "\n";
+}
+
+std::ostream& operator<<(std::ostream& os, const Profile& profile) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    os << std::left << std::setw(24) << "definition" << std::right
+       << std::setw(10) << "steps" << std::setw(14) << "substitutions"
+       << std::setw(12) << "time (us)" << "  source";
+    for(const auto& cost: profile.by_definition()) {
+        os << "\n" << std::left << std::setw(24) << cost.name << std::right
+           << std::setw(10) << cost.steps << std::setw(14)
+           << cost.substitutions << std::setw(12)
+           << duration_cast<microseconds>(cost.time).count() << "  ";
+        if(!cost.source.empty()) os << cost.source << ":";
+        if(cost.line) os << cost.line;
+    }
+    return os;
+}
+
+Profiler::Phase::~Phase() {
+    auto duration = std::chrono::steady_clock::now() - start;
+    profile.stats.*time += duration;
+    auto& samples = profile.samples;
+    if(first < samples.size()) {
+        auto share = duration / (samples.size() - first);
+        for(std::size_t i = first; i < samples.size(); ++i) {
+            samples[i].start = profile.elapsed + share * (i - first);
+            samples[i].duration = share;
+        }
+    }
+    profile.elapsed += duration;
+}
+
+void Profiler::beta_step(const Application& redex) {
+    CollectStats::beta_step(redex);
+    Profile::Sample sample;
+    sample.stack.reserve(path.size() + 1);
+    for(const Definition* d: path) sample.stack.push_back(profile.frame(d));
+    auto origin = unfold(*redex.get_function()).get_origin();
+    const Definition* code = origin ? origin->definition : nullptr;
+    if(path.empty() || path.back() != code)
+        sample.stack.push_back(profile.frame(code));
+    sample.start = profile.elapsed;
+    profile.samples.push_back(std::move(sample));
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "reduction.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains a profiler for beta reduction. Profiler is a
+ * statistics policy for the reduction engine (see reduction.hpp) that
+ * records every contraction as a Sample in a Profile. The stack of a sample
+ * consists of the definitions (see Definition in lambda-struct.hpp) of the
+ * nodes on the path from the root of the term to the redex, outermost first,
+ * followed by the definition of the lambda that is applied, i.e. of the code
+ * that created the redex. Consecutive nodes of the same definition form one
+ * frame. Nodes only have definitions if they were parsed with origin
+ * tracking (see Parser::track_origins).
+ * A Profile can be summarized per definition or written as Chrome trace
+ * (chrome://tracing, Perfetto), speedscope profile or folded stacks (for
+ * flamegraph.pl).
+ */
+
+class Profile {
+  public:
+    struct Frame {
+        /**
+         * a definition, name is "<expression>" for statements without
+         * assignment and "<unknown>" for nodes without origin
+         */
+        std::string name;
+        std::string source;
+        std::uint32_t line;
+    };
+    struct Sample {
+        /**
+         * one contraction
+         */
+        // indices into get_frames(), outermost first
+        std::vector<std::size_t> stack;
+        // since the start of the first evaluation of the profile
+        std::chrono::nanoseconds start{0};
+        std::chrono::nanoseconds duration{0};
+        unsigned long substitutions = 0;
+    };
+    struct Cost {
+        /**
+         * cost of the contractions whose redex was created by a definition
+         */
+        std::string name;
+        std::string source;
+        std::uint32_t line;
+        unsigned long steps = 0;
+        unsigned long substitutions = 0;
+        std::chrono::nanoseconds time{0};
+    };
+    Profile() : stats(), frames(), frame_index(), samples(), elapsed(0) {}
+    const std::vector<Frame>& get_frames() const noexcept {
+        return frames;
+    }
+    const std::vector<Sample>& get_samples() const noexcept {
+        return samples;
+    }
+    /** @return cost per innermost frame, most expensive first */
+    std::vector<Cost> by_definition() const;
+    /** writes the samples in the Trace Event Format as complete events */
+    void write_chrome_trace(std::ostream& os) const;
+    /** writes the samples as evented speedscope profile */
+    void write_speedscope(std::ostream& os) const;
+    /** writes one line "frame;frame;... steps" per distinct stack */
+    void write_folded(std::ostream& os) const;
+    /** statistics of all evaluations of the profile */
+    ReductionStats stats;
+  private:
+    friend class Profiler;
+    std::size_t frame(const Definition* definition);
+    std::vector<Frame> frames;
+    std::unordered_map<const Definition*, std::size_t> frame_index;
+    std::vector<Sample> samples;
+    // time of all reductions profiled so far
+    std::chrono::nanoseconds elapsed;
+};
+
+/** prints the result of Profile::by_definition as a table */
+std::ostream& operator<<(std::ostream& os, const Profile& profile);
+
+class Profiler : public CollectStats {
+    /**
+     * statistics policy that records samples into a Profile
+     */
+  public:
+    class Phase {
+        /**
+         * measures a phase like CollectStats::Phase and spreads its time
+         * over the samples recorded during it
+         */
+      public:
+        Phase(Profiler& profiler,
+              std::chrono::nanoseconds ReductionStats::* time)
+            : profile(profiler.profile), time(time),
+              first(profiler.profile.samples.size()),
+              start(std::chrono::steady_clock::now()) {}
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+        ~Phase();
+      private:
+        Profile& profile;
+        std::chrono::nanoseconds ReductionStats::* time;
+        std::size_t first;
+        std::chrono::steady_clock::time_point start;
+    };
+    class Scope {
+        /**
+         * enters the definition of a node while the engine looks at it
+         */
+      public:
+        Scope(Profiler& profiler, const Expression& ex) : path(nullptr) {
+            auto origin = ex.get_origin();
+            if(!origin) return;
+            if(!profiler.path.empty() &&
+               profiler.path.back() == origin->definition) return;
+            path = &profiler.path;
+            path->push_back(origin->definition);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope() {
+            if(path) path->pop_back();
+        }
+      private:
+        std::vector<const Definition*>* path;
+    };
+    /** @param profile profile to add to, must outlive this object */
+    explicit Profiler(Profile& profile)
+        : CollectStats(profile.stats), profile(profile), path() {}
+    void beta_step(const Application& redex);
+    void substitution() noexcept {
+        CollectStats::substitution();
+        if(!profile.samples.empty()) ++profile.samples.back().substitutions;
+    }
+  private:
+    Profile& profile;
+    std::vector<const Definition*> path;
+};
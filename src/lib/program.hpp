@@ -1,6 +1,13 @@
 #pragma once
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 #include "lambda-struct.hpp"
+#include "alpha-equivalence.hpp"
+#include "profiler.hpp"
+#include "reduction.hpp"
+#include "strategy.hpp"
 
 /**
  * ABSTRACT:
@@ -10,7 +17,8 @@
  * The most important class is Program, which is a container for a command
  * (in multi-line input, this should be the last command the user specified)
  * and a map of known_symbols (saving all commands that got assigned a name by
- * the user, e.g. by entering "'ID' = \\ x. x".
+ * the user, e.g. by entering "'ID' = \\ x. x". Uses of a name in later
+ * expressions are References to its command, see Program::reference.
  *
  * The Command-class is itself a container for an Expression (see
  * lambda-struct.hpp) and a Conversion, which can therefore be used to represent
@@ -21,8 +29,12 @@
  * alpha conversion and beta reduction.
  *
  * Every Conversion defines the polymorphic method "execute", which takes an
- * Expression_ptr (shared pointer to Expression) as argument, applies itself to
- * this Expression and returns the resulting Expression as Expression_ptr.
+ * Expression_ptr (reference counted pointer to Expression) as argument,
+ * applies itself to this Expression and returns the resulting Expression as
+ * Expression_ptr.
+ * Overloads of execute additionally collect ReductionStats (see
+ * reduction.hpp) or a Profile (see profiler.hpp), the plain one does not pay
+ * for that.
  */
 
 class Conversion {
@@ -37,6 +49,19 @@ class Conversion {
     virtual Expression_ptr execute(Expression_ptr ex) const {
         return ex;
     }
+    /** like execute(ex), adds statistics of the conversion to stats */
+    virtual Expression_ptr execute(Expression_ptr ex, ReductionStats&) const {
+        return ex;
+    }
+    /** like execute(ex), records the conversion into profile */
+    virtual Expression_ptr execute(Expression_ptr ex, Profile&) const {
+        return ex;
+    }
+    /** @return kind and parameters of the conversion, two conversions with
+     * the same description have the same effect */
+    virtual std::string describe() const {
+        return "identity";
+    }
 };
 class AlphaConversion final : public Conversion {
   public:
@@ -49,34 +74,166 @@ class AlphaConversion final : public Conversion {
     Expression_ptr execute(Expression_ptr ex) const override {
         return ex->alpha_convert(old_name, new_name);
     }
+    Expression_ptr execute(Expression_ptr ex, ReductionStats& stats) const
+        override {
+        CollectStats collect(stats);
+        CollectStats::Phase phase(collect, &ReductionStats::alpha_time);
+        collect.alpha_conversion();
+        return ex->alpha_convert(old_name, new_name);
+    }
+    Expression_ptr execute(Expression_ptr ex, Profile& profile) const
+        override {
+        return execute(ex, profile.stats);
+    }
+    std::string describe() const override {
+        return "alpha " + old_name + " " + new_name;
+    }
     std::string old_name;
     std::string new_name;
 };
 
+class BetaReduction;
+
+struct ReductionState {
+    /**
+     * a BetaReduction between two steps, everything needed to continue it
+     * as if it had not been interrupted, see BetaReduction::resume
+     */
+    // the term after steps steps
+    Expression_ptr term;
+    unsigned long steps = 0;
+    // cycle detection: the term that term is compared to after next_check
+    // steps, nullptr before the first step
+    Expression_ptr compared;
+    unsigned long next_check = 1;
+};
+
+class Checkpointer {
+    /**
+     * asked by a BetaReduction before every step whether to save its state,
+     * e.g. to a file (see checkpoint.hpp)
+     */
+  public:
+    virtual ~Checkpointer() {}
+    /** @return true if the state after steps steps should be saved */
+    virtual bool due(unsigned long steps) = 0;
+    virtual void save(const BetaReduction& beta,
+                      const ReductionState& state) = 0;
+};
+
 class BetaReduction : public Conversion {
     /**
-     * n-fold beta-reduction, where n is num_steps. Reduction may terminate
-     * early if convergence is reached.
+     * n-fold beta-reduction, where n is num_steps, in the order of strategy
+     * (see strategy.hpp). Reduction may terminate early if convergence is
+     * reached. If checkpointer is set, it may save the state of the
+     * reduction between steps.
      */
   public:
-    BetaReduction(unsigned long num_steps, unsigned long max_iter) :
-        num_steps(num_steps), max_iter(max_iter) {}
+    BetaReduction(unsigned long num_steps, unsigned long max_iter,
+                  Strategy strategy = Strategy::normal) :
+        num_steps(num_steps), max_iter(max_iter), strategy(strategy),
+        checkpointer() {}
     Expression_ptr execute(Expression_ptr ex) const override {
-        Expression_ptr newex;
-        unsigned int i;
-        for(i = 0; (i < num_steps || num_steps == 0)
+        return resume(start(ex));
+    }
+    Expression_ptr execute(Expression_ptr ex, ReductionStats& stats) const
+        override {
+        return resume(start(ex), stats);
+    }
+    Expression_ptr execute(Expression_ptr ex, Profile& profile) const
+        override {
+        Profiler profiler(profile);
+        return reduce(start(ex), profiler);
+    }
+    /** continues the reduction from state, e.g. a saved checkpoint */
+    Expression_ptr resume(ReductionState state) const {
+        NoStats stats;
+        return reduce(std::move(state), stats);
+    }
+    /** like resume(state), adds statistics of the remaining steps */
+    Expression_ptr resume(ReductionState state, ReductionStats& stats) const {
+        CollectStats collect(stats);
+        return reduce(std::move(state), collect);
+    }
+    std::string describe() const override {
+        return "beta " + std::to_string(num_steps) + " "
+               + std::to_string(max_iter) + " "
+               + std::to_string(static_cast<int>(strategy));
+    }
+    unsigned long num_steps;
+    unsigned long max_iter;
+    Strategy strategy;
+    std::shared_ptr<Checkpointer> checkpointer;
+  private:
+    static ReductionState start(Expression_ptr ex) {
+        ReductionState state;
+        state.term = std::move(ex);
+        return state;
+    }
+    template <typename Stats>
+    Expression_ptr reduce(ReductionState state, Stats& stats) const {
+        return visit(strategy, [&](auto policy) {
+            return run<decltype(policy)>(state, stats);
+        });
+    }
+    template <typename Policy, typename Stats>
+    Expression_ptr run(ReductionState& state, Stats& stats) const {
+        /**
+         * If the loop could only end at max_iter, terms that reduce to
+         * themselves (up to alpha conversion) are detected: after 2^k steps
+         * the term is compared to the one after 2^(k-1) steps, which finds
+         * every cycle whose length is a power of two at a logarithmic cost.
+         * Such a term has no normal form, so MaxIterationsExceeded is thrown
+         * right away.
+         * state.term is the only reference to the terms after the first
+         * step, so they are reduced in place (see step_in_place). The term
+         * kept for the comparison is therefore a copy.
+         */
+        unsigned long& i = state.steps;
+        Expression_ptr& ex = state.term;
+        bool unbounded = num_steps == 0
+                         || (max_iter != 0 && num_steps >= max_iter);
+        if(!state.compared) state.compared = ex;
+        stats.observe(*ex);
+        for(; (i < num_steps || num_steps == 0)
             && (i < max_iter || max_iter == 0); ++i) {
-            newex = ex->beta_reduce();
-            if(newex == ex) break;
-            ex = newex;
+            if(checkpointer && checkpointer->due(i))
+                checkpointer->save(*this, state);
+            bool changed;
+            {
+                typename Stats::Phase phase(stats,
+                                            &ReductionStats::reduction_time);
+                changed = step_in_place<Policy>(ex, stats);
+            }
+            if(!changed) break;
+            stats.observe(*ex);
+            if(unbounded && i + 1 == state.next_check) {
+                if(alpha_equivalent(*ex, *state.compared))
+                    throw MaxIterationsExceeded();
+                state.compared = reduces_in_place<Policy> ? copy_term(*ex)
+                                                           : ex;
+                state.next_check *= 2;
+            }
         }
         if(i == max_iter && max_iter != 0) {
             throw MaxIterationsExceeded();
         }
-        return newex;
+        return ex;
     }
-    unsigned long num_steps;
-    unsigned long max_iter;
+};
+
+class ResultStore {
+    /**
+     * results of commands that outlive their evaluation, e.g. on disk (see
+     * result-cache.hpp). Command::execute looks the result up before it
+     * converts and stores what it converted
+     */
+  public:
+    virtual ~ResultStore() {}
+    /** @return the result of command, nullptr if it is not known */
+    virtual Expression_ptr find(const Command& command) = 0;
+    virtual void insert(const Command& command,
+                        const Expression_ptr& result) = 0;
 };
 
 class Command {
@@ -87,10 +244,34 @@ class Command {
     Command() {}
     Command(Expression_ptr ex, std::shared_ptr<Conversion> c) : ex(ex), c(c) {}
     Expression_ptr execute() const {
-        return c->execute(ex);
+        return cached([this]() { return c->execute(ex); });
+    }
+    Expression_ptr execute(ReductionStats& stats) const {
+	/**
+	 * executes the command and adds its statistics to stats, which stay
+	 * unchanged if the result was stored
+	 */
+        return cached([&]() { return c->execute(ex, stats); });
+    }
+    Expression_ptr execute(Profile& profile) const {
+	/**
+	 * executes the command and records its reduction into profile
+	 */
+        return cached([&]() { return c->execute(ex, profile); });
     }
     Expression_ptr ex;
     std::shared_ptr<Conversion> c;
+    // consulted by execute if set, before any command is executed
+    inline static std::shared_ptr<ResultStore> results;
+  private:
+    template <typename Convert>
+    Expression_ptr cached(Convert convert) const {
+        if(!results) return convert();
+        if(Expression_ptr res = results->find(*this)) return res;
+        Expression_ptr res = convert();
+        results->insert(*this, res);
+        return res;
+    }
 };
 
 class Program {
@@ -100,7 +281,7 @@ class Program {
      * last command executed
      */
   public:
-    Program() : known_symbols() {}
+    Program() : known_symbols(), references(), definitions() {}
     inline Command& last_command() {
 	/**
 	 * returns last encountered command
@@ -122,15 +303,73 @@ class Program {
 	 */
         return known_symbols.find(key) != known_symbols.end();
     }
+    Expression_ptr reference(const std::string& name) {
+	/**
+	 * returns a Reference (see lambda-struct.hpp) to the command named
+	 * name, whose value is only computed if reduction needs it. Uses
+	 * share one node, and therefore the value, until name is assigned
+	 * again. Throws SyntaxException if there is no such command
+	 */
+        auto it = known_symbols.find(name);
+        if(it == known_symbols.end())
+            throw SyntaxException("Undefined symbol: " + name);
+        const Command& command = it->second;
+        auto& cached = references[name];
+        if(!cached.second || cached.first->ex != command.ex
+           || cached.first->c != command.c) {
+            // shared with the resolver, so that a Compactor can relocate
+            // the expression of an unresolved reference, see roots
+            auto definition = std::make_shared<Command>(command);
+            definitions.push_back(definition);
+            cached.first = definition;
+            // located where the command's expression was parsed
+            cached.second = make_node<Reference>(
+                name, [definition]() { return definition->execute(); },
+                command.ex ? command.ex->get_origin() : nullptr, definition);
+        }
+        return cached.second;
+    }
     inline explicit operator bool() {
 	/**
 	 * simple check if any known symbols exist
 	 */
         return !known_symbols.empty();
     }
-    static const std::string last_key;
+    const std::unordered_map<std::string, Command>& symbols() const noexcept {
+	/**
+	 * read access to all known symbols, including last_key
+	 */
+        return known_symbols;
+    }
+    std::vector<Expression_ptr*> roots() {
+	/**
+	 * returns every term the program holds: the expressions of the
+	 * known symbols, the cached References and the expressions that
+	 * unresolved References will execute. A Compactor (see compactor.hpp)
+	 * replaces them by relocated copies
+	 */
+        std::vector<Expression_ptr*> res;
+        for(auto& symbol: known_symbols) res.push_back(&symbol.second.ex);
+        for(auto& ref: references) res.push_back(&ref.second.second);
+        // definitions of references that are gone are forgotten here
+        std::size_t kept = 0;
+        for(auto& definition: definitions) {
+            auto command = definition.lock();
+            if(!command) continue;
+            res.push_back(&command->ex);
+            definitions[kept++] = std::move(definition);
+        }
+        definitions.resize(kept);
+        return res;
+    }
+    inline static const std::string last_key = "last";
   private:
     std::unordered_map<std::string, Command> known_symbols;
+    // the command each Reference was created for
+    std::unordered_map<std::string,
+                       std::pair<std::shared_ptr<Command>, Expression_ptr>>
+        references;
+    // the commands of all References that may still exist
+    std::vector<std::weak_ptr<Command>> definitions;
 };
 
-const std::string Program::last_key = "last";
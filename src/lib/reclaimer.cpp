@@ -0,0 +1,172 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "reclaimer.hpp"
+#include "lambda-struct.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of reclaimer.hpp
+ */
+
+namespace {
+
+std::atomic<Reclamation> current_mode{Reclamation::immediate};
+
+struct Worklist {
+    /**
+     * nodes of one thread waiting to be deleted. Trivially destructible, so
+     * it stays usable while the objects of an exiting thread are destroyed.
+     */
+    const Expression* head;
+    std::size_t size;
+    // set while the thread deletes nodes, nodes released meanwhile are
+    // only queued
+    bool active;
+    bool reclamation_thread;
+};
+
+thread_local Worklist worklist{};
+
+struct Drain {
+    /**
+     * frees what a thread queued in deferred mode when it exits
+     */
+    ~Drain() {
+        Reclaimer::collect();
+    }
+};
+
+struct Background {
+    /**
+     * the reclamation thread and the nodes handed to it
+     */
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<const Expression*> queue;
+    bool busy = false;
+    bool stop = false;
+    std::thread thread;
+
+    void run() {
+        worklist.reclamation_thread = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        for(;;) {
+            wake.wait(lock, [this]() { return stop || !queue.empty(); });
+            if(queue.empty()) break;
+            std::vector<const Expression*> batch;
+            batch.swap(queue);
+            busy = true;
+            lock.unlock();
+            for(auto ex: batch) Reclaimer::release(ex);
+            // the nodes were allocated by other threads, which need the
+            // blocks back
+            NodePool::hand_over();
+            lock.lock();
+            busy = false;
+            if(queue.empty()) idle.notify_all();
+        }
+    }
+
+    void push(const Expression* ex) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(ex);
+        }
+        wake.notify_one();
+    }
+};
+
+Background& background() {
+    // never destroyed, nodes may be released during static destruction
+    static Background* instance = new Background();
+    return *instance;
+}
+
+std::mutex& control() {
+    static std::mutex instance;
+    return instance;
+}
+
+}
+
+void Reclaimer::set_mode(Reclamation mode) {
+    std::lock_guard<std::mutex> lock(control());
+    Reclamation previous = current_mode.load();
+    if(mode == previous) return;
+    Background& bg = background();
+    if(mode == Reclamation::background) {
+        if(!atomic_refcount_default) throw ReclamationUnavailable();
+        bg.stop = false;
+        bg.thread = std::thread([&bg]() { bg.run(); });
+    }
+    current_mode.store(mode);
+    if(previous == Reclamation::background) {
+        {
+            std::lock_guard<std::mutex> lock(bg.mutex);
+            bg.stop = true;
+        }
+        bg.wake.notify_one();
+        bg.thread.join();
+    }
+}
+
+Reclamation Reclaimer::get_mode() noexcept {
+    return current_mode.load(std::memory_order_relaxed);
+}
+
+void Reclaimer::release(const Expression* ex) noexcept {
+    Reclamation mode = current_mode.load(std::memory_order_relaxed);
+    if(mode == Reclamation::background && !worklist.reclamation_thread) {
+        background().push(ex);
+        return;
+    }
+    // the reference count is 0, the field for the hash is free to link
+    // the worklist
+    ex->hash.store(reinterpret_cast<std::uintptr_t>(worklist.head),
+                   std::memory_order_relaxed);
+    worklist.head = ex;
+    ++worklist.size;
+    // a loop further up the stack deletes it
+    if(worklist.active) return;
+    if(mode == Reclamation::deferred) {
+        thread_local Drain drain;
+        (void) drain;
+        return;
+    }
+    collect();
+}
+
+std::size_t Reclaimer::collect(std::size_t max_nodes) noexcept {
+    /**
+     * deleting a node releases its children, which are linked into the
+     * worklist meanwhile instead of being deleted recursively
+     */
+    if(worklist.active) return 0;
+    worklist.active = true;
+    std::size_t freed = 0;
+    while(worklist.head && (max_nodes == 0 || freed < max_nodes)) {
+        const Expression* ex = worklist.head;
+        worklist.head = reinterpret_cast<const Expression*>(
+            ex->hash.load(std::memory_order_relaxed));
+        --worklist.size;
+        delete ex;
+        ++freed;
+    }
+    worklist.active = false;
+    return freed;
+}
+
+std::size_t Reclaimer::pending() noexcept {
+    return worklist.size;
+}
+
+void Reclaimer::wait() {
+    Background& bg = background();
+    std::unique_lock<std::mutex> lock(bg.mutex);
+    bg.idle.wait(lock, [&bg]() { return bg.queue.empty() && !bg.busy; });
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include "lambda-exceptions.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the Reclaimer, which deletes the nodes of lambda
+ * expressions (see lambda-struct.hpp) whose last reference was dropped.
+ * Deleting a node drops the references to its children, which may delete
+ * them in turn. Instead of recursing, the Reclaimer keeps the nodes still to
+ * be deleted in a worklist, so a term of any depth is freed with constant
+ * stack usage. The worklist is linked through the dead nodes themselves and
+ * needs no memory of its own.
+ * When the nodes are deleted depends on the Reclamation mode:
+ *   immediate   right away, on the thread that dropped the last reference
+ *               (default)
+ *   deferred    the thread queues them and frees them when it calls
+ *               Reclaimer::collect, at most a given number of nodes at a
+ *               time, e.g. between two requests. The rest is freed when the
+ *               thread exits.
+ *   background  a reclamation thread frees them. Only available with atomic
+ *               reference counts (LAMBDA_ATOMIC_REFCOUNT, see ref.hpp),
+ *               because the reclamation thread releases children that other
+ *               threads may still share.
+ */
+
+class Expression;
+
+enum class Reclamation {
+    immediate,
+    deferred,
+    background
+};
+
+class ReclamationUnavailable : public LambdaException {
+  public:
+    const char* what() const noexcept override {
+        return "Background reclamation requires atomic reference counts "
+               "(LAMBDA_ATOMIC_REFCOUNT)";
+    }
+};
+
+class Reclaimer {
+  public:
+    /**
+     * sets the mode for all threads. Leaving background mode waits until
+     * the reclamation thread has freed everything handed to it and stops
+     * it. Throws ReclamationUnavailable if mode is background without atomic
+     * reference counts.
+     */
+    static void set_mode(Reclamation mode);
+    static Reclamation get_mode() noexcept;
+
+    /** deletes ex, whose reference count dropped to zero, see mode */
+    static void release(const Expression* ex) noexcept;
+
+    /**
+     * frees at most max_nodes nodes queued by the calling thread in deferred
+     * mode, all of them if max_nodes is 0
+     * @return number of nodes freed
+     */
+    static std::size_t collect(std::size_t max_nodes = 0) noexcept;
+
+    /** @return number of nodes queued by the calling thread */
+    static std::size_t pending() noexcept;
+
+    /** blocks until the reclamation thread has freed everything handed to
+     * it so far, returns at once if it is not running */
+    static void wait();
+};
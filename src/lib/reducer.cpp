@@ -0,0 +1,43 @@
+#include "reducer.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of reducer.hpp
+ */
+
+namespace {
+
+class RedexRecorder : public NoStats {
+    /**
+     * remembers the origin of the redex contracted by a step
+     */
+  public:
+    void beta_step(const Application& app) noexcept {
+        redex = app.get_origin();
+    }
+    const Origin* redex = nullptr;
+};
+
+}
+
+bool Reducer::advance() {
+    if(finished) return false;
+    RedexRecorder recorder;
+    Expression_ptr next = visit(strategy, [&](auto policy) {
+        return decltype(policy)::step(*step.term, recorder);
+    });
+    if(next == step.term) {
+        finished = true;
+        return false;
+    }
+    ++step.index;
+    step.term = std::move(next);
+    step.redex = recorder.redex;
+    return true;
+}
+
+unsigned long Reducer::advance(unsigned long n) {
+    unsigned long taken = 0;
+    while(taken < n && advance()) ++taken;
+    return taken;
+}
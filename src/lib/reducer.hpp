@@ -0,0 +1,130 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include "strategy.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains Reducer, which reduces a term one step at a time, like
+ * a generator: every call of advance contracts one redex and keeps the
+ * reducer's state, so consumers can pull as many steps as they like, inspect
+ * each intermediate term and step, and stop at any point, without reducing
+ * anything twice. A Reducer is also an input range of Steps:
+ *
+ *     Reducer reducer(ex, Strategy::normal);
+ *     for(const Step& step: reducer) {
+ *         std::cout << step.index << ": " << *step.term << std::endl;
+ *         if(step.index == 10) break;
+ *     }
+ *
+ * Steps only refer to the terms, so pulling a step costs one reduction step
+ * and nothing else. BetaReduction (see program.hpp) instead runs the whole
+ * reduction and only returns the result.
+ */
+
+struct Step {
+    /**
+     * one reduction step
+     */
+    // counted from 1
+    unsigned long index = 0;
+    // the term after the step
+    Expression_ptr term;
+    // origin of the contracted redex, nullptr if unknown
+    const Origin* redex = nullptr;
+};
+
+class Reducer {
+  public:
+    class iterator {
+        /**
+         * input iterator over the steps of a Reducer, advancing it
+         */
+      public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef Step value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Step* pointer;
+        typedef const Step& reference;
+        iterator() noexcept : reducer(nullptr) {}
+        explicit iterator(Reducer* reducer) noexcept : reducer(reducer) {}
+        reference operator*() const noexcept {
+            return reducer->last_step();
+        }
+        pointer operator->() const noexcept {
+            return &reducer->last_step();
+        }
+        iterator& operator++() {
+            if(!reducer->advance()) reducer = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator& other) const noexcept {
+            return reducer == other.reducer;
+        }
+        bool operator!=(const iterator& other) const noexcept {
+            return reducer != other.reducer;
+        }
+      private:
+        Reducer* reducer;
+    };
+
+    /**
+     * @param ex term to reduce
+     * @param strategy order in which redexes are contracted
+     */
+    explicit Reducer(Expression_ptr ex, Strategy strategy = Strategy::normal)
+        : strategy(strategy), finished(false) {
+        step.term = std::move(ex);
+    }
+
+    /**
+     * contracts the next redex
+     * @return false if there is none, i.e. the term is fully reduced for the
+     * strategy
+     */
+    bool advance();
+
+    /**
+     * advances at most n steps
+     * @return number of steps taken, less than n if the term got fully
+     * reduced
+     */
+    unsigned long advance(unsigned long n);
+
+    /** @return current term */
+    const Expression_ptr& term() const noexcept {
+        return step.term;
+    }
+    /** @return number of steps taken so far */
+    unsigned long steps() const noexcept {
+        return step.index;
+    }
+    /** @return true if the term is known to be fully reduced */
+    bool done() const noexcept {
+        return finished;
+    }
+    /** @return the last step taken, index 0 if there is none yet */
+    const Step& last_step() const noexcept {
+        return step;
+    }
+    Strategy get_strategy() const noexcept {
+        return strategy;
+    }
+    /** @return the current term as a root for a Compactor (see
+     * compactor.hpp), which replaces it by an equal copy */
+    Expression_ptr* root() noexcept {
+        return &step.term;
+    }
+
+    /** takes the first step, see iterator */
+    iterator begin() {
+        return advance() ? iterator(this) : iterator();
+    }
+    iterator end() noexcept {
+        return iterator();
+    }
+  private:
+    Strategy strategy;
+    Step step;
+    bool finished;
+};
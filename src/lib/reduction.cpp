@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "reduction.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of the non-template parts of reduction.hpp
+ */
+
+ReductionStats& ReductionStats::operator+=(const ReductionStats& other) {
+    beta_steps += other.beta_steps;
+    substitutions += other.substitutions;
+    nodes_allocated += other.nodes_allocated;
+    nodes_reused += other.nodes_reused;
+    alpha_conversions += other.alpha_conversions;
+    max_size = std::max(max_size, other.max_size);
+    max_depth = std::max(max_depth, other.max_depth);
+    bytes_allocated += other.bytes_allocated;
+    peak_bytes = std::max(peak_bytes, other.peak_bytes);
+    reduction_time += other.reduction_time;
+    alpha_time += other.alpha_time;
+    return *this;
+}
+
+std::ostream& operator<<(std::ostream& os, const ReductionStats& stats) {
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+    return os << "beta steps:        " << stats.beta_steps << "\n"
+              << "substitutions:     " << stats.substitutions << "\n"
+              << "nodes allocated:   " << stats.nodes_allocated << "\n"
+              << "nodes reused:      " << stats.nodes_reused << "\n"
+              << "alpha conversions: " << stats.alpha_conversions << "\n"
+              << "max term size:     " << stats.max_size << "\n"
+              << "max term depth:    " << stats.max_depth << "\n"
+              << "node memory:       " << stats.bytes_allocated
+              << " bytes allocated, peak " << stats.peak_bytes << " bytes\n"
+              << "reduction time:    "
+              << duration_cast<microseconds>(stats.reduction_time).count()
+              << " us\n"
+              << "alpha time:        "
+              << duration_cast<microseconds>(stats.alpha_time).count()
+              << " us";
+}
+
+CollectStats::~CollectStats() {
+    const MemoryStats& now = node_memory();
+    stats.bytes_allocated += now.bytes_allocated - memory.bytes_allocated;
+    if(now.peak_bytes > memory.live_bytes)
+        stats.peak_bytes = std::max(
+            stats.peak_bytes,
+            static_cast<std::size_t>(now.peak_bytes - memory.live_bytes));
+}
+
+void CollectStats::observe(const Expression& ex) {
+    /**
+     * counts distinct nodes and computes the depth bottom-up, both without
+     * recursion
+     */
+    std::unordered_map<const Expression*, std::size_t> depth;
+    std::vector<std::pair<const Expression*, bool>> stack{{&ex, false}};
+    std::size_t size = 0;
+    while(!stack.empty()) {
+        auto [e, expanded] = stack.back();
+        stack.pop_back();
+        if(!expanded) {
+            if(depth.count(e)) continue;
+            stack.emplace_back(e, true);
+            if(auto lbd = node_cast<Lambda>(e); lbd) {
+                stack.emplace_back(lbd->get_head().get(), false);
+                stack.emplace_back(lbd->get_body().get(), false);
+            }
+            else if(auto app = node_cast<Application>(e); app) {
+                stack.emplace_back(app->get_function().get(), false);
+                stack.emplace_back(app->get_argument().get(), false);
+            }
+            continue;
+        }
+        if(depth.count(e)) continue;
+        std::size_t d = 0;
+        if(auto lbd = node_cast<Lambda>(e); lbd)
+            d = std::max(depth[lbd->get_head().get()],
+                         depth[lbd->get_body().get()]);
+        else if(auto app = node_cast<Application>(e); app)
+            d = std::max(depth[app->get_function().get()],
+                         depth[app->get_argument().get()]);
+        depth[e] = d + 1;
+        ++size;
+    }
+    stats.max_size = std::max(stats.max_size, size);
+    stats.max_depth = std::max(stats.max_depth, depth[&ex]);
+}
+
+Expression_ptr copy_term(const Expression& ex) {
+    /**
+     * copies bottom-up without recursion, like CollectStats::observe
+     */
+    std::unordered_map<const Expression*, Expression_ptr> copies;
+    std::vector<std::pair<const Expression*, bool>> stack{{&ex, false}};
+    while(!stack.empty()) {
+        auto [e, expanded] = stack.back();
+        stack.pop_back();
+        if(copies.count(e)) continue;
+        auto lbd = node_cast<Lambda>(e);
+        auto app = node_cast<Application>(e);
+        if(!lbd && !app) {
+            copies.emplace(e, e->shared_from_this());
+            continue;
+        }
+        if(!expanded) {
+            stack.emplace_back(e, true);
+            if(lbd) stack.emplace_back(lbd->get_body().get(), false);
+            else {
+                stack.emplace_back(app->get_function().get(), false);
+                stack.emplace_back(app->get_argument().get(), false);
+            }
+            continue;
+        }
+        if(lbd)
+            copies.emplace(e, make_node<Lambda>(
+                lbd->get_head(), copies[lbd->get_body().get()],
+                lbd->get_origin()));
+        else
+            copies.emplace(e, make_node<Application>(
+                copies[app->get_function().get()],
+                copies[app->get_argument().get()], app->get_origin()));
+    }
+    return copies[&ex];
+}
@@ -0,0 +1,333 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include "lambda-struct.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the reduction engine behind Expression::beta_reduce
+ * and Expression::instantiate, written as function templates over a
+ * statistics policy:
+ *   NoStats       collects nothing, all of its methods are empty, so the
+ *                 engine compiles to the same code as without statistics.
+ *                 Used by the virtual methods of lambda-struct.hpp.
+ *   CollectStats  counts into a ReductionStats object, including the node
+ *                 memory (see node-allocator.hpp) allocated while it lives.
+ *   Profiler      additionally attributes every contraction to the
+ *                 definitions it happened in, see profiler.hpp.
+ * The engine calls the policy at every event it can report (contraction,
+ * substitution, allocated or reused node) and keeps a Stats::Scope for every
+ * node on the path to the redex it is looking at. The caller (e.g.
+ * BetaReduction in program.hpp) reports term sizes via observe and measures
+ * phases with Stats::Phase.
+ * Nodes are immutable, except for reduce_in_place: a caller that owns a term
+ * lets it update the nodes that nobody else can reach (their reference count
+ * is 1 on the whole path from the root) instead of copying them, so most
+ * steps of a long reduction allocate next to nothing.
+ */
+
+struct ReductionStats {
+    /**
+     * statistics of one or more evaluations
+     */
+    // contracted redexes
+    unsigned long beta_steps = 0;
+    // variable occurrences replaced by an argument
+    unsigned long substitutions = 0;
+    // nodes created by reduction
+    unsigned long nodes_allocated = 0;
+    // subterms that were kept instead of being copied
+    unsigned long nodes_reused = 0;
+    unsigned long alpha_conversions = 0;
+    // distinct nodes of the largest term seen
+    std::size_t max_size = 0;
+    // nodes on the longest path from the root, over all terms seen
+    std::size_t max_depth = 0;
+    // node memory allocated, including nodes that were freed again
+    std::size_t bytes_allocated = 0;
+    // largest growth of live node memory during one evaluation
+    std::size_t peak_bytes = 0;
+    std::chrono::nanoseconds reduction_time{0};
+    std::chrono::nanoseconds alpha_time{0};
+
+    ReductionStats& operator+=(const ReductionStats& other);
+};
+
+/** prints one line per counter */
+std::ostream& operator<<(std::ostream& os, const ReductionStats& stats);
+
+class NoStats {
+  public:
+    static constexpr bool enabled = false;
+    struct Phase {
+        Phase(NoStats&, std::chrono::nanoseconds ReductionStats::*) noexcept {}
+    };
+    struct Scope {
+        Scope(NoStats&, const Expression&) noexcept {}
+    };
+    void beta_step(const Application&) noexcept {}
+    void substitution() noexcept {}
+    void allocated() noexcept {}
+    void reused() noexcept {}
+    void alpha_conversion() noexcept {}
+    void observe(const Expression&) noexcept {}
+};
+
+class CollectStats {
+  public:
+    static constexpr bool enabled = true;
+    class Phase {
+        /**
+         * adds the lifetime of the object to a time of stats
+         */
+      public:
+        Phase(CollectStats& collect,
+              std::chrono::nanoseconds ReductionStats::* time)
+            : stats(collect.stats), time(time),
+              start(std::chrono::steady_clock::now()) {}
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+        ~Phase() {
+            stats.*time += std::chrono::steady_clock::now() - start;
+        }
+      private:
+        ReductionStats& stats;
+        std::chrono::nanoseconds ReductionStats::* time;
+        std::chrono::steady_clock::time_point start;
+    };
+    struct Scope {
+        Scope(CollectStats&, const Expression&) noexcept {}
+    };
+    /** @param stats counters to add to, must outlive this object */
+    explicit CollectStats(ReductionStats& stats) noexcept
+        : stats(stats), memory(node_memory()) {
+        reset_peak_node_memory();
+    }
+    CollectStats(const CollectStats&) = delete;
+    CollectStats& operator=(const CollectStats&) = delete;
+    ~CollectStats();
+    void beta_step(const Application&) noexcept {
+        ++stats.beta_steps;
+    }
+    void substitution() noexcept {
+        ++stats.substitutions;
+    }
+    void allocated() noexcept {
+        ++stats.nodes_allocated;
+    }
+    void reused() noexcept {
+        ++stats.nodes_reused;
+    }
+    void alpha_conversion() noexcept {
+        ++stats.alpha_conversions;
+    }
+    /** updates max_size and max_depth with ex */
+    void observe(const Expression& ex);
+  protected:
+    ReductionStats& stats;
+  private:
+    // node memory counters of this thread at construction
+    MemoryStats memory;
+};
+
+template <typename Stats>
+Expression_ptr instantiate_term(const Expression& ex, const Variable* var,
+                                const Expression_ptr& value,
+                                Renaming& renaming, Stats& stats) {
+    /**
+     * see Expression::instantiate, var may be nullptr
+     */
+    if(auto v = node_cast<Variable>(&ex); v) {
+        if(v == var) {
+            stats.substitution();
+            return value;
+        }
+        if(auto it = renaming.find(v); it != renaming.end())
+            return it->second;
+        return ex.shared_from_this();
+    }
+    if(auto lbd = node_cast<Lambda>(&ex); lbd) {
+        const Variable* head = lbd->get_head().get();
+        auto new_head = make_node<Variable>(head->get_name(), true,
+                                            head->get_origin());
+        stats.allocated();
+        renaming[head] = new_head;
+        auto new_body = instantiate_term(*lbd->get_body(),
+                                         var == head ? nullptr : var, value,
+                                         renaming, stats);
+        renaming.erase(head);
+        stats.allocated();
+        return make_node<Lambda>(new_head, new_body, lbd->get_origin());
+    }
+    // the value of a reference is closed
+    if(node_cast<Reference>(&ex)) return ex.shared_from_this();
+    const auto& app = static_cast<const Application&>(ex);
+    auto fst = instantiate_term(*app.get_function(), var, value, renaming,
+                                stats);
+    auto snd = instantiate_term(*app.get_argument(), var, value, renaming,
+                                stats);
+    if(fst == app.get_function() && snd == app.get_argument()) {
+        stats.reused();
+        return ex.shared_from_this();
+    }
+    stats.allocated();
+    return make_node<Application>(fst, snd, app.get_origin());
+}
+
+template <typename Stats>
+Expression_ptr beta_step(const Expression& ex, Stats& stats) {
+    /**
+     * see Expression::beta_reduce: contracts the leftmost outermost redex,
+     * returns ex itself if it is in normal form
+     */
+    typename Stats::Scope scope(stats, ex);
+    if(auto lbd = node_cast<Lambda>(&ex); lbd) {
+        auto res = beta_step(*lbd->get_body(), stats);
+        if(res == lbd->get_body()) return ex.shared_from_this();
+        stats.allocated();
+        return make_node<Lambda>(lbd->get_head(), res, lbd->get_origin());
+    }
+    if(auto ref = node_cast<Reference>(&ex); ref) {
+        // reduction has reached the reference, so its value is needed
+        const auto& value = ref->get_value();
+        auto res = beta_step(*value, stats);
+        if(res == value) return ex.shared_from_this();
+        return res;
+    }
+    auto app = node_cast<Application>(&ex);
+    if(!app) return ex.shared_from_this();
+    const auto& function = app->get_function();
+    const auto& argument = app->get_argument();
+    if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd) {
+        stats.beta_step(*app);
+        Renaming renaming;
+        return instantiate_term(*lbd->get_body(), lbd->get_head().get(),
+                                argument, renaming, stats);
+    }
+    auto res1 = beta_step(*function, stats);
+    if(res1 == function) {
+        // no changes, i.e. function is in normal form
+        auto res2 = beta_step(*argument, stats);
+        if(res2 == argument) return ex.shared_from_this();
+        stats.reused();
+        stats.allocated();
+        return make_node<Application>(function, res2, app->get_origin());
+    }
+    stats.reused();
+    stats.allocated();
+    return make_node<Application>(res1, argument, app->get_origin());
+}
+
+class InPlace {
+    /**
+     * access of reduce_in_place to the children of nodes it owns. Nodes are
+     * created as non-const objects, only the Refs to them are const
+     */
+  public:
+    static Expression_ptr& body(const Lambda& lbd) noexcept {
+        return const_cast<Lambda&>(lbd).body;
+    }
+    static Expression_ptr& function(const Application& app) noexcept {
+        return const_cast<Application&>(app).function;
+    }
+    static Expression_ptr& argument(const Application& app) noexcept {
+        return const_cast<Application&>(app).argument;
+    }
+    /** forgets the hash cached in ex, whose child was replaced */
+    static void changed(const Expression& ex) noexcept {
+        ex.hash.store(0, std::memory_order_relaxed);
+    }
+};
+
+template <typename Stats>
+bool substitute_in_place(Expression_ptr& ex, const Variable* var,
+                         const Expression_ptr& value, Stats& stats) {
+    /**
+     * instantiate_term for the body of a contracted lambda that the caller
+     * owns. Owned lambdas keep their head, as there is no copy of them that
+     * they could be confused with, shared nodes are copied.
+     * @return true if ex changed
+     */
+    if(ex.get() == var) {
+        stats.substitution();
+        ex = value;
+        return true;
+    }
+    if(!ex.unique()) {
+        Renaming renaming;
+        auto res = instantiate_term(*ex, var, value, renaming, stats);
+        if(res == ex) return false;
+        ex = std::move(res);
+        return true;
+    }
+    bool changed = false;
+    if(auto lbd = node_cast<Lambda>(ex.get()); lbd) {
+        changed = substitute_in_place(InPlace::body(*lbd), var, value, stats);
+    }
+    else if(auto app = node_cast<Application>(ex.get()); app) {
+        changed = substitute_in_place(InPlace::function(*app), var, value,
+                                      stats);
+        changed |= substitute_in_place(InPlace::argument(*app), var, value,
+                                       stats);
+    }
+    if(changed) {
+        InPlace::changed(*ex);
+        stats.reused();
+    }
+    return changed;
+}
+
+template <typename Stats>
+bool reduce_in_place(Expression_ptr& ex, Stats& stats) {
+    /**
+     * beta_step for a term that only the caller refers to through ex:
+     * contracts the leftmost outermost redex, changing owned nodes in place
+     * and copying shared ones like beta_step.
+     * @return false if ex is in normal form
+     */
+    auto lbd = node_cast<Lambda>(ex.get());
+    auto app = node_cast<Application>(ex.get());
+    if(!ex.unique() || (!lbd && !app)) {
+        auto res = beta_step(*ex, stats);
+        if(res == ex) return false;
+        ex = std::move(res);
+        return true;
+    }
+    typename Stats::Scope scope(stats, *ex);
+    if(lbd) {
+        if(!reduce_in_place(InPlace::body(*lbd), stats)) return false;
+        InPlace::changed(*lbd);
+        stats.reused();
+        return true;
+    }
+    Expression_ptr& function = InPlace::function(*app);
+    if(auto redex = node_cast<Lambda>(&unfold(*function)); redex) {
+        stats.beta_step(*app);
+        if(function.get() == redex && function.unique()) {
+            // the body is substituted where it is
+            Expression_ptr body = std::move(InPlace::body(*redex));
+            substitute_in_place(body, redex->get_head().get(),
+                                app->get_argument(), stats);
+            ex = std::move(body);
+        }
+        else {
+            Renaming renaming;
+            ex = instantiate_term(*redex->get_body(), redex->get_head().get(),
+                                  app->get_argument(), renaming, stats);
+        }
+        return true;
+    }
+    if(!reduce_in_place(function, stats)
+       && !reduce_in_place(InPlace::argument(*app), stats))
+        return false;
+    InPlace::changed(*app);
+    stats.reused();
+    return true;
+}
+
+/**
+ * @return copy of ex that shares no Lambda or Application with it, e.g. to
+ * keep a term while ex is reduced in place. Variables and references are
+ * shared, sharing within ex is preserved
+ */
+Expression_ptr copy_term(const Expression& ex);
@@ -0,0 +1,199 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * ABSTRACT:
+ * This header contains Ref, an intrusive reference counting smart pointer.
+ * The count lives in the object (which derives from RefCounted), so a Ref is
+ * a single pointer, and a Ref can be created from a raw pointer at any time,
+ * e.g. from this, without a weak pointer.
+ * Ref<T, false> counts with plain loads and stores, which is enough as long as
+ * only one thread at a time uses the objects it points to, and is the
+ * default. Ref<T, true> counts with atomic instructions, like std::shared_ptr,
+ * for objects that several threads use concurrently. Both can point to the
+ * same object, but all handles that are copied or destroyed concurrently must
+ * be atomic. Compiling with LAMBDA_ATOMIC_REFCOUNT makes atomic the default.
+ * The last Ref to an object deletes it, unless T has a static member function
+ * dispose(p), which is then called instead, e.g. to delete the children of
+ * deep structures without recursion.
+ */
+
+#ifdef LAMBDA_ATOMIC_REFCOUNT
+constexpr bool atomic_refcount_default = true;
+#else
+constexpr bool atomic_refcount_default = false;
+#endif
+
+class RefCounted {
+    /**
+     * base class of all objects managed by Ref. Copies start without
+     * references.
+     */
+  public:
+    RefCounted() noexcept : refs(0) {}
+    RefCounted(const RefCounted&) noexcept : refs(0) {}
+    RefCounted& operator=(const RefCounted&) noexcept {
+        return *this;
+    }
+    /** @return number of Refs to this object */
+    std::uint32_t use_count() const noexcept {
+        return refs.load(std::memory_order_relaxed);
+    }
+  protected:
+    ~RefCounted() = default;
+  private:
+    template <typename T, bool Atomic> friend class Ref;
+    // mutable, const objects are reference counted as well
+    mutable std::atomic<std::uint32_t> refs;
+};
+
+template <typename T, bool Atomic = atomic_refcount_default>
+class Ref {
+    /**
+     * owns one reference to an object of type T (which derives from
+     * RefCounted) and deletes it when the last Ref to it is destroyed.
+     * The interface follows std::shared_ptr.
+     */
+  public:
+    typedef T element_type;
+    constexpr Ref() noexcept : p(nullptr) {}
+    constexpr Ref(std::nullptr_t) noexcept : p(nullptr) {}
+    /** @param p object to refer to, adds a reference to it */
+    explicit Ref(T* p) noexcept : p(p) {
+        retain();
+    }
+    Ref(const Ref& other) noexcept : p(other.p) {
+        retain();
+    }
+    Ref(Ref&& other) noexcept : p(other.p) {
+        other.p = nullptr;
+    }
+    template <typename U, bool A,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(const Ref<U, A>& other) noexcept : p(other.get()) {
+        retain();
+    }
+    template <typename U, bool A,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(Ref<U, A>&& other) noexcept : p(other.release()) {}
+    ~Ref() {
+        drop();
+    }
+    Ref& operator=(Ref other) noexcept {
+        swap(other);
+        return *this;
+    }
+    void swap(Ref& other) noexcept {
+        std::swap(p, other.p);
+    }
+    void reset() noexcept {
+        drop();
+        p = nullptr;
+    }
+    /** gives up the reference without decrementing the count */
+    T* release() noexcept {
+        return std::exchange(p, nullptr);
+    }
+    T* get() const noexcept {
+        return p;
+    }
+    T& operator*() const noexcept {
+        return *p;
+    }
+    T* operator->() const noexcept {
+        return p;
+    }
+    explicit operator bool() const noexcept {
+        return p != nullptr;
+    }
+    std::uint32_t use_count() const noexcept {
+        return p ? p->use_count() : 0;
+    }
+    /** @return true if this is the only Ref to the object. Uses of the
+     * object by threads that dropped their Refs happen before the call */
+    bool unique() const noexcept {
+        return p && static_cast<const RefCounted*>(p)->refs.load(
+            std::memory_order_acquire) == 1;
+    }
+  private:
+    void retain() const noexcept {
+        if(!p) return;
+        auto& refs = static_cast<const RefCounted*>(p)->refs;
+        if constexpr(Atomic) refs.fetch_add(1, std::memory_order_relaxed);
+        else refs.store(refs.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+    }
+    void drop() noexcept {
+        if(!p) return;
+        auto& refs = static_cast<const RefCounted*>(p)->refs;
+        std::uint32_t left;
+        if constexpr(Atomic)
+            left = refs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        else {
+            left = refs.load(std::memory_order_relaxed) - 1;
+            refs.store(left, std::memory_order_relaxed);
+        }
+        if(left == 0) destroy(p, 0);
+    }
+    template <typename U>
+    static auto destroy(U* p, int) noexcept -> decltype(U::dispose(p)) {
+        U::dispose(p);
+    }
+    template <typename U>
+    static void destroy(U* p, long) noexcept {
+        delete p;
+    }
+    T* p;
+};
+
+template <typename T, bool A, typename U, bool B>
+bool operator==(const Ref<T, A>& a, const Ref<U, B>& b) noexcept {
+    return a.get() == b.get();
+}
+
+template <typename T, bool A, typename U, bool B>
+bool operator!=(const Ref<T, A>& a, const Ref<U, B>& b) noexcept {
+    return a.get() != b.get();
+}
+
+template <typename T, bool A>
+bool operator==(const Ref<T, A>& a, std::nullptr_t) noexcept {
+    return !a;
+}
+
+template <typename T, bool A>
+bool operator!=(const Ref<T, A>& a, std::nullptr_t) noexcept {
+    return bool(a);
+}
+
+template <typename T, bool A, typename U, bool B>
+bool operator<(const Ref<T, A>& a, const Ref<U, B>& b) noexcept {
+    return std::less<const void*>()(a.get(), b.get());
+}
+
+template <typename T, typename U, bool A>
+Ref<T, A> static_pointer_cast(const Ref<U, A>& r) noexcept {
+    return Ref<T, A>(static_cast<T*>(r.get()));
+}
+
+template <typename T, typename U, bool A>
+Ref<T, A> dynamic_pointer_cast(const Ref<U, A>& r) noexcept {
+    /**
+     * @return Ref to the same object if it is a T, else an empty Ref
+     */
+    return Ref<T, A>(dynamic_cast<T*>(r.get()));
+}
+
+namespace std {
+template <typename T, bool A>
+struct hash<Ref<T, A>> {
+    std::size_t operator()(const Ref<T, A>& r) const noexcept {
+        return std::hash<T*>()(r.get());
+    }
+};
+}
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "result-cache.hpp"
+#include "script-loader.hpp"
+#include "serialization.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of result-cache.hpp
+ */
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char MAGIC[] = "LCRC";
+const std::size_t MAGIC_SIZE = 4;
+// 2: keys contain the names of bound variables
+const std::uint8_t VERSION = 2;
+const char EXTENSION[] = ".lcrc";
+
+void put_varint(std::string& out, std::uint64_t value) {
+    // unsigned LEB128, like BinaryWriter
+    do {
+        std::uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if(value) byte |= 0x80;
+        out.push_back(static_cast<char>(byte));
+    } while(value);
+}
+
+bool get_varint(std::string_view buf, std::size_t& pos,
+                std::uint64_t& value) {
+    value = 0;
+    for(unsigned shift = 0; shift < 64 && pos < buf.size(); shift += 7) {
+        auto byte = static_cast<std::uint8_t>(buf[pos++]);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+std::uint64_t fnv1a(std::string_view data, std::uint64_t basis) noexcept {
+    /**
+     * FNV-1a, followed by the finalizer of MurmurHash3 to spread the bits
+     */
+    std::uint64_t h = basis;
+    for(char c: data) {
+        h ^= static_cast<std::uint8_t>(c);
+        h *= 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+std::string hash128(std::string_view data) {
+    /**
+     * @return 16 bytes, two 64 bit hashes with different bases
+     */
+    std::string res;
+    for(std::uint64_t basis: {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull}) {
+        std::uint64_t h = fnv1a(data, basis);
+        for(int i = 0; i < 8; ++i)
+            res.push_back(static_cast<char>(h >> (8 * i)));
+    }
+    return res;
+}
+
+bool is_beta_reduction(const Command& command) {
+    return command.ex && dynamic_pointer_cast<BetaReduction>(command.c);
+}
+
+bool has_unresolved_references(const Expression& root) {
+    /**
+     * resolved references are stored as their value, which is searched as
+     * well
+     */
+    std::unordered_set<const Expression*> seen;
+    std::vector<const Expression*> stack{&root};
+    while(!stack.empty()) {
+        const Expression* ex = stack.back();
+        stack.pop_back();
+        if(!seen.insert(ex).second) continue;
+        if(auto lbd = node_cast<Lambda>(ex))
+            stack.push_back(lbd->get_body().get());
+        else if(auto app = node_cast<Application>(ex)) {
+            stack.push_back(app->get_function().get());
+            stack.push_back(app->get_argument().get());
+        }
+        else if(auto ref = node_cast<Reference>(ex)) {
+            if(!ref->is_resolved()) return true;
+            stack.push_back(ref->get_value().get());
+        }
+    }
+    return false;
+}
+
+std::string unique_suffix() {
+    /**
+     * @return name part that no other writer uses at the same time, for
+     * temporary files
+     */
+    static const std::uint64_t process = std::random_device()()
+        ^ (static_cast<std::uint64_t>(std::random_device()()) << 32);
+    static std::atomic<unsigned long> counter{0};
+    return std::to_string(process) + "-"
+        + std::to_string(std::hash<std::thread::id>()(
+              std::this_thread::get_id())) + "-"
+        + std::to_string(counter++);
+}
+
+}
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats) {
+    return os << "cache hits:        " << stats.hits << "\n"
+              << "cache misses:      " << stats.misses << "\n"
+              << "results stored:    " << stats.stores << "\n"
+              << "results evicted:   " << stats.evictions;
+}
+
+ResultCache::ResultCache(std::string directory, std::uintmax_t max_bytes)
+    : directory(std::move(directory)), max_bytes(max_bytes), estimate(0),
+      scanned(false), stats(), digests(),
+      prune_digests(min_prune_digests), mutex() {
+    std::error_code ec;
+    fs::create_directories(this->directory, ec);
+    if(ec || !fs::is_directory(this->directory, ec))
+        throw FileError("Could not create cache directory: "
+                        + this->directory);
+}
+
+Expression_ptr ResultCache::find(const Command& command) {
+    if(!is_beta_reduction(command)) return nullptr;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    std::string k = key(command);
+    if(k.empty()) return nullptr;
+    std::string file = path(k);
+    try {
+        MappedFile entry(file);
+        std::string_view buf = entry.view();
+        std::size_t pos = MAGIC_SIZE + 1;
+        std::uint64_t size;
+        if(buf.size() > pos
+           && buf.substr(0, MAGIC_SIZE) == std::string_view(MAGIC, MAGIC_SIZE)
+           && static_cast<std::uint8_t>(buf[MAGIC_SIZE]) == VERSION
+           && get_varint(buf, pos, size) && size <= buf.size() - pos
+           && buf.substr(pos, size) == k) {
+            Expression_ptr res = read_expression(buf.substr(pos + size));
+            // least recently used is least recently modified
+            std::error_code ec;
+            fs::last_write_time(file, fs::file_time_type::clock::now(), ec);
+            ++stats.hits;
+            return res;
+        }
+    }
+    catch (LambdaException&) {
+        // no such entry (FileError) or a damaged one (SerializationError)
+    }
+    ++stats.misses;
+    return nullptr;
+}
+
+void ResultCache::insert(const Command& command,
+                         const Expression_ptr& result) {
+    if(!result || !is_beta_reduction(command)
+       || has_unresolved_references(*result))
+        return;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    std::string k = key(command);
+    if(k.empty()) return;
+    std::string file = path(k);
+    std::string tmp = file + "." + unique_suffix() + ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if(!out) return;
+        std::string header(MAGIC, MAGIC_SIZE);
+        header.push_back(static_cast<char>(VERSION));
+        put_varint(header, k.size());
+        out << header << k;
+        write_expression(out, result);
+        if(!out) {
+            out.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+    auto size = fs::file_size(tmp, ec);
+    // replaces an entry another process stored meanwhile, which is equal
+    fs::rename(tmp, file, ec);
+    if(ec) {
+        fs::remove(tmp, ec);
+        return;
+    }
+    ++stats.stores;
+    estimate += size;
+    if(!scanned || estimate > max_bytes) evict();
+}
+
+std::string ResultCache::key(const Command& command) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    std::string res;
+    if(!command.ex || !encode(*command.ex, res)) return std::string();
+    res.push_back('C');
+    res += command.c ? command.c->describe() : Conversion().describe();
+    return res;
+}
+
+void ResultCache::evict() {
+    /**
+     * oldest modification time first, see find
+     */
+    struct Entry {
+        fs::file_time_type time;
+        std::uintmax_t size;
+        fs::path path;
+    };
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    std::vector<Entry> entries;
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for(fs::directory_iterator it(directory, ec), end; !ec && it != end;
+        it.increment(ec)) {
+        if(it->path().extension() != EXTENSION) continue;
+        std::error_code e;
+        Entry entry{it->last_write_time(e), it->file_size(e), it->path()};
+        if(e) continue;
+        total += entry.size;
+        entries.push_back(std::move(entry));
+    }
+    scanned = true;
+    if(total > max_bytes) {
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry& a, const Entry& b) {
+                      return a.time < b.time;
+                  });
+        for(const Entry& entry: entries) {
+            if(total <= max_bytes / 4 * 3) break;
+            // another process may have removed it already
+            if(fs::remove(entry.path, ec)) ++stats.evictions;
+            total -= entry.size;
+        }
+    }
+    estimate = total;
+}
+
+bool ResultCache::encode(const Expression& root, std::string& out) {
+    /**
+     * like BinaryWriter::write_nodes: post-order, every node once, children
+     * by the distance to them in the node table. Variables are written with
+     * their name, as the names of bound variables show in the result, and
+     * references as the digest of their definition
+     */
+    std::unordered_map<const Expression*, std::size_t> index;
+    std::vector<std::pair<const Expression*, bool>> stack{{&root, false}};
+    auto put_ref = [&](const Expression_ptr& child) {
+        put_varint(out, index.size() - index.at(child.get()));
+    };
+    while(!stack.empty()) {
+        auto [ex, expanded] = stack.back();
+        if(index.count(ex)) {
+            stack.pop_back();
+            continue;
+        }
+        auto lbd = node_cast<Lambda>(ex);
+        auto app = node_cast<Application>(ex);
+        if((lbd || app) && !expanded) {
+            stack.back().second = true;
+            if(lbd) {
+                stack.emplace_back(lbd->get_body().get(), false);
+                stack.emplace_back(lbd->get_head().get(), false);
+            }
+            else {
+                stack.emplace_back(app->get_argument().get(), false);
+                stack.emplace_back(app->get_function().get(), false);
+            }
+            continue;
+        }
+        stack.pop_back();
+        if(lbd) {
+            out.push_back('L');
+            put_ref(lbd->get_head());
+            put_ref(lbd->get_body());
+        }
+        else if(app) {
+            out.push_back('A');
+            put_ref(app->get_function());
+            put_ref(app->get_argument());
+        }
+        else if(auto var = node_cast<Variable>(ex)) {
+            out.push_back(var->is_bound() ? 'B' : 'F');
+            put_varint(out, var->get_name().size());
+            out += var->get_name();
+        }
+        else {
+            auto ref = node_cast<Reference>(ex);
+            out.push_back('R');
+            if(!digest(ref->get_definition(), out)) return false;
+        }
+        index.emplace(ex, index.size());
+    }
+    out.push_back('E');
+    put_varint(out, index.size() - index.at(&root));
+    return true;
+}
+
+bool ResultCache::digest(const std::shared_ptr<const Command>& definition,
+                         std::string& out) {
+    /**
+     * appends the hash of the key of definition, computed once per
+     * definition. Definitions only refer to earlier ones, so the recursion
+     * ends. Whenever the digests have doubled, those of definitions that
+     * are gone (e.g. redefined names) are dropped
+     */
+    if(!definition) return false;
+    auto it = digests.find(definition.get());
+    if(it == digests.end() || it->second.first.lock() != definition) {
+        std::string k = key(*definition);
+        if(k.empty()) return false;
+        if(digests.size() >= prune_digests) {
+            for(auto d = digests.begin(); d != digests.end();) {
+                if(d->second.first.expired()) d = digests.erase(d);
+                else ++d;
+            }
+            prune_digests = std::max(min_prune_digests, 2 * digests.size());
+        }
+        digests[definition.get()] = {definition, hash128(k)};
+        it = digests.find(definition.get());
+    }
+    out += it->second.second;
+    return true;
+}
+
+std::string ResultCache::path(const std::string& key) const {
+    static const char hex[] = "0123456789abcdef";
+    std::string name;
+    for(char c: hash128(key)) {
+        name.push_back(hex[static_cast<std::uint8_t>(c) >> 4]);
+        name.push_back(hex[static_cast<std::uint8_t>(c) & 0xf]);
+    }
+    return (fs::path(directory) / (name + EXTENSION)).string();
+}
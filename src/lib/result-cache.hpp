@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include "program.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the ResultCache, which keeps the results of beta
+ * reductions on disk, so that processes that evaluate the same terms (today
+ * or days later) reduce them only once:
+ *
+ *     Command::results = std::make_shared<ResultCache>("lambda-cache");
+ *     ... every Command::execute consults the cache from now on ...
+ *
+ * An entry is keyed by the term and the conversion (kind, step limit and
+ * strategy, see Conversion::describe). The key is an encoding of the term
+ * (as in serialization.hpp, a node table with back-references). It keeps
+ * the names of bound variables, which the result inherits: a term that is
+ * only alpha equivalent to a stored one would print differently, so it is
+ * a miss. A Reference is encoded by a digest of its definition, i.e. the
+ * key of the command it stands for, not by its name; references without a
+ * definition and results that contain unresolved references (which only
+ * mean something in their program) are not cached.
+ * Every entry is a file named after a 128 bit hash of its key. It holds the
+ * key, which is compared on lookup, so a collision of hashes is a miss, and
+ * the result in the format of serialization.hpp.
+ * Several processes may use the same directory: entries are written to a
+ * temporary file and renamed, so readers see whole entries or none, and
+ * readers map files, which stay readable after another process removed
+ * them. A hit sets the modification time of the entry, and once the entries
+ * exceed max_bytes, the least recently used are removed until they take up
+ * three quarters of it. Every process estimates the size from its own
+ * stores and rescans the directory when the estimate exceeds max_bytes, so
+ * the bound is approximate while several processes store entries.
+ */
+
+struct ResultCacheStats {
+    /**
+     * lookups and stores of one ResultCache
+     */
+    unsigned long hits = 0;
+    unsigned long misses = 0;
+    unsigned long stores = 0;
+    unsigned long evictions = 0;
+};
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats);
+
+class ResultCache final : public ResultStore {
+  public:
+    static constexpr std::uintmax_t default_max_bytes = 256 * 1024 * 1024;
+    /**
+     * @param directory where the entries are, created if it does not exist.
+     * Throws FileError if that fails
+     * @param max_bytes bound of the size of all entries
+     */
+    explicit ResultCache(std::string directory,
+                         std::uintmax_t max_bytes = default_max_bytes);
+    /** @return stored result of command, nullptr if there is none or
+     * command is not a beta reduction */
+    Expression_ptr find(const Command& command) override;
+    /** stores result as the result of command, if it can be cached. Errors
+     * are ignored, the cache is only an optimization */
+    void insert(const Command& command, const Expression_ptr& result) override;
+    /**
+     * @return the key of command, empty if it cannot be cached, e.g. because
+     * it refers to a Reference without definition
+     */
+    std::string key(const Command& command);
+    /** removes least recently used entries if the entries exceed max_bytes,
+     * see the ABSTRACT */
+    void evict();
+    const ResultCacheStats& get_stats() const noexcept {
+        return stats;
+    }
+    const std::string& get_directory() const noexcept {
+        return directory;
+    }
+    /** @return number of definitions whose digest is kept, see digest */
+    std::size_t digest_count() const noexcept {
+        return digests.size();
+    }
+  private:
+    static constexpr std::size_t min_prune_digests = 64;
+    bool encode(const Expression& ex, std::string& out);
+    bool digest(const std::shared_ptr<const Command>& definition,
+                std::string& out);
+    std::string path(const std::string& key) const;
+    std::string directory;
+    std::uintmax_t max_bytes;
+    // bytes of the entries, as of the last scan and this process's stores
+    std::uintmax_t estimate;
+    bool scanned;
+    ResultCacheStats stats;
+    // digests of definitions, see digest. The weak_ptr tells whether the
+    // command at the address is still the one the digest is of
+    std::unordered_map<const Command*,
+                       std::pair<std::weak_ptr<const Command>, std::string>>
+        digests;
+    // size of digests at which those of dead definitions are dropped
+    std::size_t prune_digests;
+    // several threads may execute commands
+    std::recursive_mutex mutex;
+};
@@ -0,0 +1,182 @@
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "script-loader.hpp"
+#include "lambda-syntax.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LAMBDA_HAVE_MMAP 1
+#endif
+
+/**
+ * ABSTRACT:
+ * Implementation of script-loader.hpp
+ */
+
+MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0),
+    mapped(false), fallback() {
+#ifdef LAMBDA_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw FileError("Could not open file: " + path);
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) {
+            data = static_cast<const char*>(p);
+            size = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+    if(mapped) return;
+#endif
+    // no mmap available, the file is empty or could not be mapped
+    std::ifstream in(path, std::ios::binary);
+    if(!in) throw FileError("Could not open file: " + path);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    fallback = ss.str();
+    data = fallback.data();
+    size = fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef LAMBDA_HAVE_MMAP
+    if(mapped) munmap(const_cast<char*>(data), size);
+#endif
+}
+
+std::vector<std::string_view> split_statements(std::string_view source) {
+    std::vector<std::string_view> result;
+    std::size_t start = 0;
+    std::size_t i = 0;
+    while(i < source.size()) {
+        char c = source[i];
+        if(c == static_cast<char>(Symbol::comment)) {
+            // separators inside comments do not end a statement
+            i = source.find('\n', i);
+            if(i == std::string_view::npos) break;
+        }
+        else if(c == static_cast<char>(Symbol::separator)) {
+            result.push_back(source.substr(start, i + 1 - start));
+            start = i + 1;
+        }
+        ++i;
+    }
+    if(start < source.size()) result.push_back(source.substr(start));
+    return result;
+}
+
+namespace {
+
+struct ParsedStatement {
+    /**
+     * result of parsing one statement without access to the Program:
+     * the command, the name it is assigned to (empty if none) and the
+     * placeholders for all NAMEs it refers to
+     */
+    bool empty = true;
+    std::string name;
+    Command command;
+    std::vector<std::pair<std::string, Variable_ptr>> unresolved;
+    std::exception_ptr error;
+};
+
+struct Position {
+    /**
+     * where a statement starts within the script
+     */
+    std::size_t offset;
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+void parse_statement(std::string_view source, unsigned long max_iter,
+                     const std::string& source_name, bool track_origins,
+                     const Position& pos, ParsedStatement& out) {
+    try {
+        BufferParser parser(source, max_iter);
+        parser.defer_names(true);
+        parser.track_origins(track_origins);
+        parser.set_source(source_name, pos.offset, pos.line, pos.column);
+        Program p = parser.statement();
+        if(!p.contains(Program::last_key)) return;
+        out.empty = false;
+        out.command = p.last_command();
+        for(const auto& symbol: p.symbols())
+            if(symbol.first != Program::last_key) out.name = symbol.first;
+        out.unresolved = parser.unresolved();
+    }
+    catch(...) {
+        out.error = std::current_exception();
+    }
+}
+
+}
+
+void load_script(Program& program, std::string_view source,
+                 unsigned threads, unsigned long max_iter,
+                 const std::string& source_name, bool track_origins) {
+    auto statements = split_statements(source);
+    std::vector<ParsedStatement> parsed(statements.size());
+    std::vector<Position> positions(statements.size());
+    Position pos{0, 1, 1};
+    for(std::size_t i = 0; i < statements.size(); ++i) {
+        positions[i] = pos;
+        const auto& s = statements[i];
+        for(std::size_t nl = s.find('\n'), last = std::string_view::npos;
+            ; nl = s.find('\n', nl + 1)) {
+            if(nl == std::string_view::npos) {
+                if(last == std::string_view::npos) pos.column += s.size();
+                else pos.column = s.size() - last;
+                break;
+            }
+            ++pos.line;
+            last = nl;
+        }
+        pos.offset += s.size();
+    }
+
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    if(threads == 0) threads = 1;
+    if(threads > statements.size()) threads = statements.size();
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        for(std::size_t i = next++; i < statements.size(); i = next++)
+            parse_statement(statements[i], max_iter, source_name,
+                            track_origins, positions[i], parsed[i]);
+    };
+    if(threads <= 1) worker();
+    else {
+        std::vector<std::thread> pool;
+        for(unsigned t = 0; t < threads; ++t) pool.emplace_back(worker);
+        for(auto& t: pool) t.join();
+    }
+
+    // link in source order: every statement may only refer to names that
+    // have been defined by the statements before it
+    for(auto& s: parsed) {
+        if(s.error) std::rethrow_exception(s.error);
+        if(s.empty) continue;
+        for(const auto& p: s.unresolved) {
+            auto value = program.reference(p.first);
+            s.command.ex = s.command.ex->substitute(p.second, value);
+        }
+        if(!s.name.empty()) program[s.name] = s.command;
+        program[Program::last_key] = s.command;
+    }
+}
+
+void load_script_file(Program& program, const std::string& path,
+                      unsigned threads, unsigned long max_iter,
+                      bool track_origins) {
+    MappedFile file(path);
+    load_script(program, file.view(), threads, max_iter, path,
+                track_origins);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "program.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains functions to load whole scripts (e.g. libraries of
+ * definitions) into a Program.
+ * A script is split into its statements at every separator that is not part
+ * of a comment. The statements are then parsed on several threads, each with
+ * its own BufferParser (see lambda-syntax.hpp) that defers the lookup of
+ * NAMEs. Afterwards, the statements are linked into the Program one by one in
+ * source order, so every statement sees exactly the definitions that precede
+ * it, just like when parsing the script serially.
+ * Files are memory-mapped where possible, so the parsers read directly from
+ * the page cache.
+ */
+
+class MappedFile {
+    /**
+     * read-only view of a whole file. Uses mmap on POSIX systems and falls
+     * back to reading the file into memory otherwise.
+     */
+  public:
+    /** @param path file to map, throws FileError if it can not be read */
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+    /** @return contents of the file, valid as long as this object lives */
+    std::string_view view() const noexcept {
+        return std::string_view(data, size);
+    }
+  private:
+    const char* data;
+    std::size_t size;
+    bool mapped;
+    std::string fallback;
+};
+
+/**
+ * splits source into statements at every separator outside of comments
+ * @return one view per statement, including its separator. Trailing text
+ * after the last separator is returned as last element if it is not empty
+ */
+std::vector<std::string_view> split_statements(std::string_view source);
+
+/**
+ * parses all statements in source and adds them to program, as if they had
+ * been parsed one after another by a single Parser
+ * @param threads number of parser threads, 0 for one per hardware thread
+ * @param max_iter see Parser
+ * @param source_name name of the script in the Origins of its nodes
+ * @param track_origins see Parser::track_origins
+ */
+void load_script(Program& program, std::string_view source,
+                 unsigned threads = 0, unsigned long max_iter = 0,
+                 const std::string& source_name = "",
+                 bool track_origins = false);
+
+/**
+ * memory-maps the file at path and loads it via load_script, with path as
+ * source name
+ */
+void load_script_file(Program& program, const std::string& path,
+                      unsigned threads = 0, unsigned long max_iter = 0,
+                      bool track_origins = false);
@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <fstream>
+#include "serialization.hpp"
+#include "script-loader.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of serialization.hpp
+ */
+
+namespace {
+
+const char MAGIC[] = "LCBF";
+const std::size_t MAGIC_SIZE = 4;
+// flush the write buffer whenever it exceeds this size
+const std::size_t BUFFER_SIZE = 1 << 16;
+
+enum Record : std::uint8_t {
+    name_record = 'N',
+    free_record = 'F',
+    binder_record = 'B',
+    lambda_record = 'L',
+    application_record = 'A',
+    reference_record = 'R',
+    expression_record = 'E',
+    definition_record = 'D',
+    end_record = 'Z'
+};
+
+enum ConversionKind : std::uint8_t {
+    no_conversion = 0,
+    alpha_conversion = 1,
+    beta_reduction = 2,
+    // beta reduction with a strategy other than Strategy::normal
+    strategy_reduction = 3
+};
+
+}
+
+BinaryWriter::BinaryWriter(std::ostream& os, bool keep_references)
+    : os(os), buffer(), finished(false), keep_references(keep_references),
+      nodes(), aliases(), node_index(), names() {
+    buffer.append(MAGIC, MAGIC_SIZE);
+    put(version);
+}
+
+BinaryWriter::~BinaryWriter() {
+    if(!finished) flush();
+}
+
+void BinaryWriter::write(const Expression_ptr& ex) {
+    std::size_t root = write_nodes(ex);
+    put(expression_record);
+    put_ref(root);
+}
+
+void BinaryWriter::write(const std::string& name, const Command& command) {
+    if(!command.ex) return;
+    std::size_t root = write_nodes(command.ex);
+    // all names have to be in the table before the record refers to them
+    std::size_t n = name_index(name);
+    auto alpha_c = dynamic_pointer_cast<AlphaConversion>(command.c);
+    auto beta_c = dynamic_pointer_cast<BetaReduction>(command.c);
+    std::size_t old_name = 0, new_name = 0;
+    if(alpha_c) {
+        old_name = name_index(alpha_c->old_name);
+        new_name = name_index(alpha_c->new_name);
+    }
+    put(definition_record);
+    put_varint(n);
+    put_ref(root);
+    if(alpha_c) {
+        put(alpha_conversion);
+        put_varint(old_name);
+        put_varint(new_name);
+    }
+    else if(beta_c) {
+        bool normal = beta_c->strategy == Strategy::normal;
+        put(normal ? beta_reduction : strategy_reduction);
+        put_varint(beta_c->num_steps);
+        put_varint(beta_c->max_iter);
+        if(!normal) put(static_cast<std::uint8_t>(beta_c->strategy));
+    }
+    else put(no_conversion);
+}
+
+void BinaryWriter::write(const Program& program) {
+    std::vector<std::string> keys;
+    for(const auto& symbol: program.symbols()) keys.push_back(symbol.first);
+    std::sort(keys.begin(), keys.end());
+    for(const auto& key: keys) write(key, program.symbols().at(key));
+}
+
+void BinaryWriter::finish() {
+    if(finished) return;
+    put(end_record);
+    flush();
+    os.flush();
+    finished = true;
+}
+
+std::size_t BinaryWriter::write_nodes(const Expression_ptr& root) {
+    // iterative post-order traversal, children are written before their
+    // parents and every node only once
+    if(auto it = node_index.find(root.get()); it != node_index.end())
+        return it->second;
+    std::vector<std::pair<Expression_ptr, bool>> stack;
+    stack.emplace_back(root, false);
+    while(!stack.empty()) {
+        Expression_ptr ex = stack.back().first;
+        if(node_index.count(ex.get())) {
+            stack.pop_back();
+            continue;
+        }
+        auto r = node_cast<Reference>(ex.get());
+        if(r && keep_references) {
+            std::size_t n = name_index(r->get_name());
+            put(reference_record);
+            put_varint(n);
+            stack.pop_back();
+            node_index[ex.get()] = nodes.size();
+            nodes.push_back(ex);
+            continue;
+        }
+        if(r) {
+            // written as its value
+            const Expression_ptr& value = r->get_value();
+            if(auto it = node_index.find(value.get()); it != node_index.end()) {
+                node_index[ex.get()] = it->second;
+                aliases.push_back(ex);
+                stack.pop_back();
+            }
+            else stack.emplace_back(value, false);
+            continue;
+        }
+        Expression_ptr fst, snd;
+        auto var = node_cast<Variable>(ex.get());
+        if(auto l = node_cast<Lambda>(ex.get()); l) {
+            fst = l->get_head();
+            snd = l->get_body();
+        }
+        else if(auto a = node_cast<Application>(ex.get()); a) {
+            fst = a->get_function();
+            snd = a->get_argument();
+        }
+        else if(!var) throw SerializationError("unknown expression type");
+        if(!var && !stack.back().second) {
+            stack.back().second = true;
+            stack.emplace_back(snd, false);
+            stack.emplace_back(fst, false);
+            continue;
+        }
+        stack.pop_back();
+        if(var) {
+            std::size_t n = name_index(var->get_name());
+            put(var->is_bound() ? binder_record : free_record);
+            put_varint(n);
+        }
+        else {
+            bool is_lambda = ex->get_kind() == NodeKind::lambda;
+            put(is_lambda ? lambda_record : application_record);
+            put_ref(node_index.at(fst.get()));
+            put_ref(node_index.at(snd.get()));
+        }
+        node_index[ex.get()] = nodes.size();
+        nodes.push_back(ex);
+    }
+    return node_index.at(root.get());
+}
+
+std::size_t BinaryWriter::name_index(const std::string& name) {
+    auto it = names.find(name);
+    if(it != names.end()) return it->second;
+    std::size_t n = names.size();
+    names.emplace(name, n);
+    put(name_record);
+    put_varint(name.size());
+    buffer.append(name);
+    return n;
+}
+
+void BinaryWriter::put(std::uint8_t byte) {
+    buffer.push_back(static_cast<char>(byte));
+    if(buffer.size() >= BUFFER_SIZE) flush();
+}
+
+void BinaryWriter::put_varint(std::uint64_t value) {
+    // unsigned LEB128
+    do {
+        std::uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if(value) byte |= 0x80;
+        put(byte);
+    } while(value);
+}
+
+void BinaryWriter::put_ref(std::size_t node) {
+    put_varint(nodes.size() - node);
+}
+
+void BinaryWriter::flush() {
+    os.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+BinaryReader::BinaryReader(std::string_view buf, Program* program)
+    : buf(buf), program(program), pos(0), nodes(), kinds(), names(),
+      ended(false), last_name(), command() {
+    if(buf.substr(0, MAGIC_SIZE) != std::string_view(MAGIC, MAGIC_SIZE))
+        throw SerializationError("missing header");
+    pos = MAGIC_SIZE;
+    if(get() != BinaryWriter::version)
+        throw SerializationError("unsupported version");
+}
+
+bool BinaryReader::next() {
+    while(!ended) {
+        std::uint8_t tag = get();
+        switch(tag) {
+            case name_record: {
+                auto len = get_varint();
+                if(len > buf.size() - pos)
+                    throw SerializationError("unexpected end of stream");
+                names.emplace_back(buf.substr(pos, len));
+                pos += len;
+                break;
+            }
+            case free_record:
+            case binder_record:
+                nodes.push_back(make_node<Variable>(
+                        get_name(), tag == binder_record));
+                kinds.push_back(tag);
+                break;
+            case lambda_record: {
+                std::size_t head_pos = nodes.size() - get_varint();
+                if(head_pos >= nodes.size()
+                   || kinds[head_pos] != binder_record)
+                    throw SerializationError("invalid binder reference");
+                auto head = static_pointer_cast<const Variable>(
+                        nodes[head_pos]);
+                auto body = get_ref();
+                nodes.push_back(make_node<Lambda>(head, body));
+                kinds.push_back(tag);
+                break;
+            }
+            case application_record: {
+                auto function = get_ref();
+                auto argument = get_ref();
+                nodes.push_back(make_node<Application>(function, argument));
+                kinds.push_back(tag);
+                break;
+            }
+            case reference_record: {
+                const std::string& name = get_name();
+                if(!program)
+                    throw SerializationError("reference to " + name
+                                             + " without a program");
+                if(!program->contains(name))
+                    throw SerializationError("undefined reference: " + name);
+                nodes.push_back(program->reference(name));
+                kinds.push_back(tag);
+                break;
+            }
+            case expression_record:
+                last_name.clear();
+                command = Command(get_ref(), std::make_shared<Conversion>());
+                return true;
+            case definition_record: {
+                last_name = get_name();
+                auto ex = get_ref();
+                command = Command(ex, read_conversion());
+                return true;
+            }
+            case end_record:
+                ended = true;
+                break;
+            default:
+                throw SerializationError("unknown record");
+        }
+    }
+    return false;
+}
+
+std::uint8_t BinaryReader::get() {
+    if(pos >= buf.size()) throw SerializationError("unexpected end of stream");
+    return static_cast<std::uint8_t>(buf[pos++]);
+}
+
+std::uint64_t BinaryReader::get_varint() {
+    std::uint64_t value = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7) {
+        std::uint8_t byte = get();
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return value;
+    }
+    throw SerializationError("malformed integer");
+}
+
+Expression_ptr BinaryReader::get_ref() {
+    auto distance = get_varint();
+    if(distance == 0 || distance > nodes.size())
+        throw SerializationError("invalid node reference");
+    return nodes[nodes.size() - distance];
+}
+
+const std::string& BinaryReader::get_name() {
+    auto n = get_varint();
+    if(n >= names.size()) throw SerializationError("invalid name reference");
+    return names[n];
+}
+
+std::shared_ptr<Conversion> BinaryReader::read_conversion() {
+    switch(get()) {
+        case no_conversion:
+            return std::make_shared<Conversion>();
+        case alpha_conversion: {
+            std::string old_name = get_name();
+            std::string new_name = get_name();
+            return std::make_shared<AlphaConversion>(old_name, new_name);
+        }
+        case beta_reduction: {
+            auto num_steps = get_varint();
+            auto max_iter = get_varint();
+            return std::make_shared<BetaReduction>(num_steps, max_iter);
+        }
+        case strategy_reduction: {
+            auto num_steps = get_varint();
+            auto max_iter = get_varint();
+            auto strategy = get();
+            if(strategy > static_cast<std::uint8_t>(Strategy::development))
+                throw SerializationError("unknown strategy");
+            return std::make_shared<BetaReduction>(
+                num_steps, max_iter, static_cast<Strategy>(strategy));
+        }
+        default:
+            throw SerializationError("unknown conversion");
+    }
+}
+
+void write_expression(std::ostream& os, const Expression_ptr& ex) {
+    BinaryWriter writer(os);
+    writer.write(ex);
+    writer.finish();
+}
+
+Expression_ptr read_expression(std::string_view buf) {
+    BinaryReader reader(buf);
+    while(reader.next()) {
+        if(reader.name().empty()) return reader.expression();
+    }
+    throw SerializationError("no expression in stream");
+}
+
+void write_program(std::ostream& os, const Program& program) {
+    BinaryWriter writer(os);
+    writer.write(program);
+    writer.finish();
+}
+
+void read_program(Program& program, std::string_view buf) {
+    BinaryReader reader(buf);
+    while(reader.next()) {
+        if(!reader.name().empty())
+            program[reader.name()] = reader.last_command();
+    }
+}
+
+void save_program(const Program& program, const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if(!out) throw FileError("Could not open file: " + path);
+    write_program(out, program);
+    if(!out) throw FileError("Could not write file: " + path);
+}
+
+void load_program(Program& program, const std::string& path) {
+    MappedFile file(path);
+    read_program(program, file.view());
+}
+
+void save_snapshot(const Program& program, const std::string& path) {
+    Program evaluated;
+    for(const auto& symbol: program.symbols()) {
+        if(symbol.first == Program::last_key || !symbol.second.ex) continue;
+        evaluated[symbol.first] = Command(symbol.second.execute(),
+                                          std::make_shared<Conversion>());
+    }
+    save_program(evaluated, path);
+}
+
+void load_snapshot(Program& program, const std::string& path) {
+    load_program(program, path);
+}
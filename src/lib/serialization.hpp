@@ -0,0 +1,174 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "program.hpp"
+
+/**
+ * ABSTRACT:
+ * This header defines a compact, versioned binary format for Expressions and
+ * Programs, together with a streaming writer (BinaryWriter) and reader
+ * (BinaryReader).
+ *
+ * A stream starts with the magic bytes "LCBF" and a version byte, followed by
+ * records. Every record is a tag byte followed by its operands, all integers
+ * are unsigned LEB128 varints:
+ *   'N' len bytes            appends a name to the name table
+ *   'F' name                 appends a free variable to the node table
+ *   'B' name                 appends a binder (lambda head) to the node table
+ *   'L' head body            appends a Lambda to the node table
+ *   'A' function argument    appends an Application to the node table
+ *   'R' name                 appends a Reference to the definition name
+ *   'E' node                 an expression
+ *   'D' name node conversion a named Command
+ *   'Z'                      end of stream
+ * The conversion of a Command is a kind byte followed by its operands:
+ * 0 for no conversion, 1 old_name new_name for alpha conversion,
+ * 2 num_steps max_iter for beta reduction in normal order and
+ * 3 num_steps max_iter strategy for beta reduction with another strategy,
+ * where strategy is a byte (see Strategy in strategy.hpp).
+ * Nodes refer to their children by back-reference, i.e. by the distance to
+ * the child in the node table. Every node is written exactly once, so shared
+ * subterms stay shared after reading, and later expressions in the same
+ * stream can refer to the nodes of earlier ones.
+ * References (see lambda-struct.hpp) are written as their value, unless
+ * the writer keeps them: then they are 'R' records, which the reader
+ * resolves with Program::reference, so the value is not computed before it
+ * is needed. Checkpoints (see checkpoint.hpp) keep references.
+ * Bound variables are not identified by their name but by position: every
+ * occurrence refers to the node of its binder, the name is only kept for
+ * printing. (Plain de Bruijn indices are not used, because the index of an
+ * occurrence depends on its context and would prevent sharing subterms that
+ * occur under different numbers of binders.)
+ */
+
+class SerializationError : public LambdaException {
+  public:
+    SerializationError(std::string txt) : txt("SerializationError: " + txt) {}
+    const char* what() const noexcept override {
+      return txt.c_str();
+    }
+  private:
+    std::string txt;
+};
+
+class BinaryWriter {
+    /**
+     * writes Expressions and Commands to a std::ostream. Output is buffered
+     * and only guaranteed to be complete after finish() or destruction.
+     */
+  public:
+    static const std::uint8_t version = 1;
+    /** writes the header to os. If keep_references, References are written
+     * as such, else as their value */
+    explicit BinaryWriter(std::ostream& os, bool keep_references = false);
+    BinaryWriter(const BinaryWriter&) = delete;
+    BinaryWriter& operator=(const BinaryWriter&) = delete;
+    ~BinaryWriter();
+    /** writes ex, reusing all nodes that have already been written */
+    void write(const Expression_ptr& ex);
+    /** writes a named command */
+    void write(const std::string& name, const Command& command);
+    /** writes all symbols of program, sorted by name */
+    void write(const Program& program);
+    /** writes the end of stream marker and flushes */
+    void finish();
+  private:
+    std::size_t write_nodes(const Expression_ptr& ex);
+    std::size_t name_index(const std::string& name);
+    void put(std::uint8_t byte);
+    void put_varint(std::uint64_t value);
+    void put_ref(std::size_t node);
+    void flush();
+    std::ostream& os;
+    std::string buffer;
+    bool finished;
+    bool keep_references;
+    // written nodes are kept alive, so their addresses stay unique
+    std::vector<Expression_ptr> nodes;
+    // references written as their value share its index, and are kept alive
+    // for the same reason
+    std::vector<Expression_ptr> aliases;
+    std::unordered_map<const Expression*, std::size_t> node_index;
+    std::unordered_map<std::string, std::size_t> names;
+};
+
+class BinaryReader {
+    /**
+     * reads Expressions and Commands from a buffer, e.g. a memory-mapped
+     * file (see MappedFile in script-loader.hpp). Throws SerializationError
+     * on malformed input.
+     */
+  public:
+    /** checks the header, buf must outlive the reader. References are
+     * resolved in program, a stream with references cannot be read
+     * without */
+    explicit BinaryReader(std::string_view buf, Program* program = nullptr);
+    /**
+     * reads records up to the next expression or definition
+     * @return false at the end of the stream
+     */
+    bool next();
+    /** @return expression read by the last call to next */
+    Expression_ptr expression() const {
+        return command.ex;
+    }
+    /** @return name of the definition read by the last call to next,
+     * empty for an expression */
+    const std::string& name() const noexcept {
+        return last_name;
+    }
+    /** @return command read by the last call to next, an expression is
+     * returned with identity conversion */
+    const Command& last_command() const noexcept {
+        return command;
+    }
+  private:
+    std::uint8_t get();
+    std::uint64_t get_varint();
+    Expression_ptr get_ref();
+    const std::string& get_name();
+    std::shared_ptr<Conversion> read_conversion();
+    std::string_view buf;
+    Program* program;
+    std::size_t pos;
+    std::vector<Expression_ptr> nodes;
+    // record tag of every node, to check the type of references
+    std::vector<std::uint8_t> kinds;
+    std::vector<std::string> names;
+    bool ended;
+    std::string last_name;
+    Command command;
+};
+
+/** writes a stream containing only ex to os */
+void write_expression(std::ostream& os, const Expression_ptr& ex);
+
+/** @return the first expression in the stream in buf */
+Expression_ptr read_expression(std::string_view buf);
+
+/** writes a stream containing all symbols of program to os */
+void write_program(std::ostream& os, const Program& program);
+
+/** adds all definitions in the stream in buf to program */
+void read_program(Program& program, std::string_view buf);
+
+/** writes program to the file at path, throws FileError on failure */
+void save_program(const Program& program, const std::string& path);
+
+/** memory-maps the file at path and reads all definitions into program */
+void load_program(Program& program, const std::string& path);
+
+/**
+ * writes a snapshot of program to the file at path: every symbol except
+ * Program::last_key is stored as the result of its execute() with identity
+ * conversion, so loading the snapshot restores the evaluated symbol table
+ * without parsing or reducing anything
+ */
+void save_snapshot(const Program& program, const std::string& path);
+
+/** adds all symbols of the snapshot at path to program */
+void load_snapshot(Program& program, const std::string& path);
@@ -0,0 +1,321 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "church-encoding.hpp"
+#include "lambda-exceptions.hpp"
+#include "lambda-struct.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains StaticTerm, a lambda expression that is parsed at
+ * compile time into a table of nodes, for terms that are fixed in the C++
+ * code, e.g. combinators:
+ *
+ *     constexpr auto K = R"(\ a . \ b . a)"_lambda;
+ *     Expression_ptr k = static_term<K>();
+ *
+ * The syntax is that of <expression> in grammar.txt without NAMEs, which
+ * only exist at run time. A malformed term in a constexpr StaticTerm is a
+ * compile error: the parser throws, which is not a constant expression.
+ * StaticTerm::build creates the nodes of the table without parsing,
+ * static_term builds them once per term and shares them from then on:
+ * process-wide with atomic reference counts (LAMBDA_ATOMIC_REFCOUNT, see
+ * ref.hpp), else once per thread, as threads must not share nodes whose
+ * counts are not atomic.
+ * The "..."_lambda literal needs the string literal operator templates of
+ * GCC and Clang; elsewhere, construct StaticTerm from the string literal,
+ * e.g. constexpr StaticTerm K("\\ a . \\ b . a").
+ */
+
+enum class StaticKind : std::uint8_t {
+    /**
+     * the kind of a node of a StaticTerm
+     */
+    variable,
+    lambda,
+    application,
+    // Church numeral or boolean, see church-encoding.hpp
+    number,
+    boolean
+};
+
+struct StaticNode {
+    /**
+     * one node of a StaticTerm. Children are referred to by index and
+     * always come before their parent
+     */
+    StaticKind kind = StaticKind::variable;
+    // variables only: true for the head of a lambda
+    bool bound = false;
+    // variable: offset of the name in the text, lambda: head,
+    // application: function, number and boolean: value
+    std::uint32_t first = 0;
+    // variable: length of the name, lambda: body, application: argument
+    std::uint32_t second = 0;
+};
+
+template <std::size_t N>
+class StaticTerm {
+    /**
+     * an expression parsed at compile time from a string literal of N
+     * characters (including the terminating null), which has at most N
+     * nodes. Bound variables are the node of their lambda's head, free
+     * variables get one node per occurrence, as with the Parser.
+     */
+  public:
+    constexpr StaticTerm(const char (&source)[N]) : StaticTerm(source, 0) {
+        if(error)
+            throw SyntaxException(std::string(error) + " at offset "
+                                  + std::to_string(pos));
+    }
+
+    /**
+     * @return nullptr if source is a valid term, else the reason it is not,
+     * e.g. for static_assert
+     */
+    static constexpr const char* check(const char (&source)[N]) {
+        return StaticTerm(source, 0).error;
+    }
+
+    constexpr std::size_t node_count() const noexcept {
+        return size;
+    }
+    constexpr const StaticNode& node(std::size_t i) const noexcept {
+        return nodes[i];
+    }
+    /** @return index of the node of the whole term */
+    constexpr std::size_t get_root() const noexcept {
+        return root;
+    }
+    /** @return name of a variable node */
+    constexpr std::string_view name(const StaticNode& var) const noexcept {
+        return std::string_view(text + var.first, var.second);
+    }
+
+    /** @return new nodes for the term, without parsing */
+    Expression_ptr build() const {
+        std::vector<Expression_ptr> built(size);
+        for(std::size_t i = 0; i < size; ++i) {
+            const StaticNode& n = nodes[i];
+            switch(n.kind) {
+                case StaticKind::variable:
+                    built[i] = make_node<Variable>(std::string(name(n)),
+                                                   n.bound);
+                    break;
+                case StaticKind::lambda:
+                    built[i] = make_node<Lambda>(
+                        static_pointer_cast<const Variable>(built[n.first]),
+                        built[n.second]);
+                    break;
+                case StaticKind::application:
+                    built[i] = make_node<Application>(built[n.first],
+                                                      built[n.second]);
+                    break;
+                case StaticKind::number:
+                    built[i] = church_encode(n.first);
+                    break;
+                case StaticKind::boolean:
+                    built[i] = n.first ? church_true() : church_false();
+                    break;
+            }
+        }
+        return built[root];
+    }
+
+  private:
+    constexpr StaticTerm(const char (&source)[N], int)
+        : text(), nodes(), size(0), root(0), pos(0), error(nullptr),
+          scope(), depth(0) {
+        for(std::size_t i = 0; i < N; ++i) text[i] = source[i];
+        root = expression();
+        skip();
+        if(!error && !at_end()) fail("unexpected character");
+    }
+
+    static constexpr bool is_lower(char c) noexcept {
+        return c >= 'a' && c <= 'z';
+    }
+    static constexpr bool is_upper(char c) noexcept {
+        return c >= 'A' && c <= 'Z';
+    }
+    static constexpr bool is_digit(char c) noexcept {
+        return c >= '0' && c <= '9';
+    }
+    static constexpr bool is_space(char c) noexcept {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+    constexpr bool at_end() const noexcept {
+        return pos + 1 >= N || text[pos] == '\0';
+    }
+
+    constexpr void skip() noexcept {
+        /**
+         * skips whitespace and comments
+         */
+        while(!at_end()) {
+            if(is_space(text[pos])) ++pos;
+            else if(text[pos] == '#') {
+                while(!at_end() && text[pos] != '\n') ++pos;
+            }
+            else break;
+        }
+    }
+
+    constexpr std::uint32_t fail(const char* reason) noexcept {
+        if(!error) error = reason;
+        return 0;
+    }
+
+    constexpr std::uint32_t add(StaticNode n) noexcept {
+        nodes[size] = n;
+        return static_cast<std::uint32_t>(size++);
+    }
+
+    constexpr std::uint32_t word() noexcept {
+        /**
+         * @return length of the identifier at pos, which is skipped
+         */
+        std::size_t start = pos;
+        while(!at_end() && (is_lower(text[pos]) || is_upper(text[pos])))
+            ++pos;
+        return static_cast<std::uint32_t>(pos - start);
+    }
+
+    constexpr bool equal(std::uint32_t a, std::uint32_t b,
+                         std::uint32_t length) const noexcept {
+        for(std::uint32_t i = 0; i < length; ++i)
+            if(text[a + i] != text[b + i]) return false;
+        return true;
+    }
+
+    constexpr int boolean(std::uint32_t start,
+                          std::uint32_t length) const noexcept {
+        /**
+         * @return 1 for "true", 0 for "false", -1 for other identifiers
+         */
+        std::string_view w(text + start, length);
+        if(w == "true") return 1;
+        if(w == "false") return 0;
+        return -1;
+    }
+
+    constexpr std::uint32_t expression() {
+        /**
+         * parses one <expression>, @return index of its node
+         */
+        skip();
+        if(error) return 0;
+        if(at_end()) return fail("unexpected end of term");
+        char c = text[pos];
+        if(c == '\\') {
+            ++pos;
+            skip();
+            if(at_end() || !is_lower(text[pos]))
+                return fail("malformed lambda");
+            auto start = static_cast<std::uint32_t>(pos);
+            std::uint32_t length = word();
+            if(boolean(start, length) >= 0) return fail("malformed lambda");
+            std::uint32_t head = add({StaticKind::variable, true, start,
+                                      length});
+            skip();
+            if(at_end() || text[pos] != '.') return fail("malformed lambda");
+            ++pos;
+            scope[depth++] = head;
+            std::uint32_t body = expression();
+            --depth;
+            if(error) return 0;
+            return add({StaticKind::lambda, false, head, body});
+        }
+        if(c == '(') {
+            ++pos;
+            std::uint32_t function = expression();
+            skip();
+            if(error) return 0;
+            if(at_end() || text[pos] != ')')
+                return fail("unmatched bracket");
+            ++pos;
+            std::uint32_t argument = expression();
+            if(error) return 0;
+            return add({StaticKind::application, false, function,
+                        argument});
+        }
+        if(is_lower(c)) {
+            auto start = static_cast<std::uint32_t>(pos);
+            std::uint32_t length = word();
+            if(int b = boolean(start, length); b >= 0)
+                return add({StaticKind::boolean, false,
+                            static_cast<std::uint32_t>(b), 0});
+            // innermost binding first
+            for(std::size_t i = depth; i > 0; --i) {
+                const StaticNode& head = nodes[scope[i - 1]];
+                if(head.second == length && equal(head.first, start, length))
+                    return scope[i - 1];
+            }
+            return add({StaticKind::variable, false, start, length});
+        }
+        if(is_digit(c)) {
+            std::uint32_t value = 0;
+            while(!at_end() && is_digit(text[pos])) {
+                std::uint32_t digit = static_cast<std::uint32_t>(
+                    text[pos++] - '0');
+                if(value > (UINT32_MAX - digit) / 10)
+                    return fail("literal out of range");
+                value = value * 10 + digit;
+            }
+            return add({StaticKind::number, false, value, 0});
+        }
+        if(is_upper(c))
+            return fail("NAMEs cannot be resolved at compile time");
+        return fail("unexpected character");
+    }
+
+    char text[N];
+    StaticNode nodes[N];
+    std::size_t size;
+    std::size_t root;
+    // parser state
+    std::size_t pos;
+    const char* error;
+    // heads of the lambdas enclosing the current node
+    std::uint32_t scope[N];
+    std::size_t depth;
+};
+
+template <std::size_t N>
+StaticTerm(const char (&)[N]) -> StaticTerm<N>;
+
+template <const auto& term>
+const Expression_ptr& static_term() {
+    /**
+     * @return the nodes of term (a StaticTerm with static storage), built on
+     * the first call, see the ABSTRACT. Shared nodes are never freed, like a
+     * table of constants; per thread nodes are freed when the thread exits
+     */
+#ifdef LAMBDA_ATOMIC_REFCOUNT
+    static const Expression_ptr* ex = new Expression_ptr(term.build());
+    return *ex;
+#else
+    thread_local const Expression_ptr ex = term.build();
+    return ex;
+#endif
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+template <typename Char, Char... chars>
+constexpr StaticTerm<sizeof...(chars) + 1> operator""_lambda() {
+    /**
+     * "..."_lambda: the term parsed at compile time, see StaticTerm
+     */
+    const char source[] = {chars..., '\0'};
+    return StaticTerm<sizeof...(chars) + 1>(source);
+}
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,38 @@
+#include "strategy.hpp"
+
+/**
+ * ABSTRACT:
+ * Implementation of the non-template parts of strategy.hpp
+ */
+
+namespace {
+
+const Strategy strategies[] = {Strategy::normal, Strategy::applicative,
+                               Strategy::call_by_value, Strategy::head,
+                               Strategy::weak_head, Strategy::development};
+
+}
+
+const char* strategy_name(Strategy strategy) noexcept {
+    switch(strategy) {
+        case Strategy::applicative:
+            return "applicative";
+        case Strategy::call_by_value:
+            return "cbv";
+        case Strategy::head:
+            return "head";
+        case Strategy::weak_head:
+            return "whnf";
+        case Strategy::development:
+            return "development";
+        case Strategy::normal:
+            break;
+    }
+    return "normal";
+}
+
+Strategy parse_strategy(const std::string& name) {
+    for(Strategy s: strategies)
+        if(name == strategy_name(s)) return s;
+    throw SyntaxException("Unknown reduction strategy: " + name);
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include <string>
+#include <type_traits>
+#include "reduction.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains the reduction strategies of the engine in
+ * reduction.hpp as policy classes. Every strategy has a static member
+ * function template step(ex, stats), which contracts the next redex the
+ * strategy picks and returns the result, or returns ex itself if the
+ * strategy considers ex fully reduced:
+ *   NormalOrder       leftmost outermost redex, until normal form (default,
+ *                     see beta_step)
+ *   ApplicativeOrder  leftmost innermost redex, i.e. function and argument
+ *                     are normalized before the application is contracted
+ *   CallByValue       like ApplicativeOrder, but never reduces inside a
+ *                     lambda, i.e. stops at weak normal form
+ *   HeadOrder         only the head redex, until head normal form: inside
+ *                     lambdas, but never in arguments
+ *   WeakHeadOrder     only the head redex outside of lambdas, until weak
+ *                     head normal form (call-by-name)
+ *   CompleteDevelopment
+ *                     every redex of the term at once (Gross-Knuth): one
+ *                     step contracts all redexes present before the step,
+ *                     so terms with many independent redexes need far fewer
+ *                     passes over the term. Repeated complete developments
+ *                     reach the normal form whenever one exists, so results
+ *                     agree with NormalOrder (Gross-Knuth reduction is
+ *                     normalizing, normal forms are unique).
+ * A Reference (see lambda-struct.hpp) is only resolved when the strategy
+ * reaches it, so e.g. NormalOrder never computes the value of a NAME in an
+ * argument that is dropped before it would be reduced.
+ * step_in_place runs a step on a term the caller owns, in place for
+ * NormalOrder (see reduce_in_place), by copying for the others.
+ * Strategy names a strategy at run time, e.g. for BetaReduction in
+ * program.hpp and the syntax "expression > strategy;" (see grammar.txt).
+ */
+
+enum class Strategy {
+    normal,
+    applicative,
+    call_by_value,
+    head,
+    weak_head,
+    development
+};
+
+/** @return name of strategy as used in the syntax, e.g. "cbv" */
+const char* strategy_name(Strategy strategy) noexcept;
+
+/**
+ * @param name as returned by strategy_name
+ * @return strategy with this name, throws SyntaxException if there is none
+ */
+Strategy parse_strategy(const std::string& name);
+
+template <typename Stats>
+Expression_ptr contract(const Application& app, const Lambda& lbd,
+                        Stats& stats) {
+    /**
+     * @return body of lbd with the argument of app substituted
+     */
+    stats.beta_step(app);
+    Renaming renaming;
+    return instantiate_term(*lbd.get_body(), lbd.get_head().get(),
+                            app.get_argument(), renaming, stats);
+}
+
+template <typename Stats>
+Expression_ptr rebuild(const Lambda& lbd, Expression_ptr body, Stats& stats) {
+    /**
+     * @return lbd with body replaced, lbd itself if body is its body
+     */
+    if(body == lbd.get_body()) return lbd.shared_from_this();
+    stats.allocated();
+    return make_node<Lambda>(lbd.get_head(), std::move(body),
+                             lbd.get_origin());
+}
+
+template <typename Stats>
+Expression_ptr rebuild(const Application& app, Expression_ptr function,
+                       Expression_ptr argument, Stats& stats) {
+    /**
+     * @return app with function and argument replaced, app itself if both
+     * are unchanged
+     */
+    if(function == app.get_function() && argument == app.get_argument())
+        return app.shared_from_this();
+    stats.reused();
+    stats.allocated();
+    return make_node<Application>(std::move(function), std::move(argument),
+                                  app.get_origin());
+}
+
+template <typename Policy, typename Stats>
+Expression_ptr step_value(const Reference& ref, Stats& stats) {
+    /**
+     * @return value of ref after one step of Policy, ref itself if Policy
+     * considers the value fully reduced
+     */
+    const auto& value = ref.get_value();
+    auto res = Policy::step(*value, stats);
+    if(res == value) return ref.shared_from_this();
+    return res;
+}
+
+struct NormalOrder {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        return beta_step(ex, stats);
+    }
+};
+
+struct ApplicativeOrder {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        typename Stats::Scope scope(stats, ex);
+        if(auto lbd = node_cast<Lambda>(&ex); lbd)
+            return rebuild(*lbd, step(*lbd->get_body(), stats), stats);
+        if(auto ref = node_cast<Reference>(&ex); ref)
+            return step_value<ApplicativeOrder>(*ref, stats);
+        auto app = node_cast<Application>(&ex);
+        if(!app) return ex.shared_from_this();
+        const auto& function = app->get_function();
+        const auto& argument = app->get_argument();
+        if(auto res = step(*function, stats); res != function)
+            return rebuild(*app, res, argument, stats);
+        if(auto res = step(*argument, stats); res != argument)
+            return rebuild(*app, function, res, stats);
+        if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd)
+            return contract(*app, *lbd, stats);
+        return ex.shared_from_this();
+    }
+};
+
+struct CallByValue {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        typename Stats::Scope scope(stats, ex);
+        if(auto ref = node_cast<Reference>(&ex); ref)
+            return step_value<CallByValue>(*ref, stats);
+        auto app = node_cast<Application>(&ex);
+        if(!app) return ex.shared_from_this();
+        const auto& function = app->get_function();
+        const auto& argument = app->get_argument();
+        if(auto res = step(*function, stats); res != function)
+            return rebuild(*app, res, argument, stats);
+        if(auto res = step(*argument, stats); res != argument)
+            return rebuild(*app, function, res, stats);
+        if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd)
+            return contract(*app, *lbd, stats);
+        return ex.shared_from_this();
+    }
+};
+
+struct HeadOrder {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        typename Stats::Scope scope(stats, ex);
+        if(auto lbd = node_cast<Lambda>(&ex); lbd)
+            return rebuild(*lbd, step(*lbd->get_body(), stats), stats);
+        if(auto ref = node_cast<Reference>(&ex); ref)
+            return step_value<HeadOrder>(*ref, stats);
+        auto app = node_cast<Application>(&ex);
+        if(!app) return ex.shared_from_this();
+        const auto& function = app->get_function();
+        if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd)
+            return contract(*app, *lbd, stats);
+        return rebuild(*app, step(*function, stats), app->get_argument(),
+                       stats);
+    }
+};
+
+struct WeakHeadOrder {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        typename Stats::Scope scope(stats, ex);
+        if(auto ref = node_cast<Reference>(&ex); ref)
+            return step_value<WeakHeadOrder>(*ref, stats);
+        auto app = node_cast<Application>(&ex);
+        if(!app) return ex.shared_from_this();
+        const auto& function = app->get_function();
+        if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd)
+            return contract(*app, *lbd, stats);
+        return rebuild(*app, step(*function, stats), app->get_argument(),
+                       stats);
+    }
+};
+
+struct CompleteDevelopment {
+    template <typename Stats>
+    static Expression_ptr step(const Expression& ex, Stats& stats) {
+        /**
+         * develops function, argument and body of a redex before it is
+         * contracted, so redexes created by the contraction are left to
+         * the next step
+         */
+        typename Stats::Scope scope(stats, ex);
+        if(auto lbd = node_cast<Lambda>(&ex); lbd)
+            return rebuild(*lbd, step(*lbd->get_body(), stats), stats);
+        if(auto ref = node_cast<Reference>(&ex); ref)
+            return step_value<CompleteDevelopment>(*ref, stats);
+        auto app = node_cast<Application>(&ex);
+        if(!app) return ex.shared_from_this();
+        const auto& function = app->get_function();
+        auto argument = step(*app->get_argument(), stats);
+        if(auto lbd = node_cast<Lambda>(&unfold(*function)); lbd) {
+            auto body = step(*lbd->get_body(), stats);
+            stats.beta_step(*app);
+            Renaming renaming;
+            return instantiate_term(*body, lbd->get_head().get(),
+                                    std::move(argument), renaming, stats);
+        }
+        return rebuild(*app, step(*function, stats), std::move(argument),
+                       stats);
+    }
+};
+
+template <typename Policy>
+constexpr bool reduces_in_place = std::is_same_v<Policy, NormalOrder>;
+
+template <typename Policy, typename Stats>
+bool step_in_place(Expression_ptr& ex, Stats& stats) {
+    /**
+     * one step of Policy on ex, which only the caller refers to, in place
+     * where Policy supports it (see reduce_in_place)
+     * @return false if Policy considers ex fully reduced
+     */
+    if constexpr(reduces_in_place<Policy>) {
+        return reduce_in_place(ex, stats);
+    }
+    else {
+        auto res = Policy::step(*ex, stats);
+        if(res == ex) return false;
+        ex = std::move(res);
+        return true;
+    }
+}
+
+template <typename Visitor>
+decltype(auto) visit(Strategy strategy, Visitor&& visitor) {
+    /**
+     * calls visitor with a default constructed object of the policy class
+     * of strategy, like visit for nodes in lambda-struct.hpp
+     */
+    switch(strategy) {
+        case Strategy::applicative:
+            return visitor(ApplicativeOrder());
+        case Strategy::call_by_value:
+            return visitor(CallByValue());
+        case Strategy::head:
+            return visitor(HeadOrder());
+        case Strategy::weak_head:
+            return visitor(WeakHeadOrder());
+        case Strategy::development:
+            return visitor(CompleteDevelopment());
+        case Strategy::normal:
+            break;
+    }
+    return visitor(NormalOrder());
+}
@@ -1,10 +1,17 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <memory>
 #include <regex>
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <set>
+#include <unordered_map>
+#include <vector>
+#include "char-scan.hpp"
 #include "lambda-exceptions.hpp"
 
 /**
@@ -12,6 +19,13 @@
  * This file defines the class Tokenizer, which reads characters from a
  * std::istream and parses them into Tokens.
  * Tokenizer::get can then be used to retrieve Tokens one by one
+ *
+ * For input that is already in memory (a std::string, a file buffer or a
+ * memory-mapped file), the class BufferTokenizer provides the same interface
+ * without copying: it returns TokenViews, whose text is a slice of the input
+ * buffer, and classifies characters through a precomputed table instead of
+ * one std::istream::get per character. Runs of whitespace, letters and
+ * digits are skipped 16 or 32 bytes at a time, see char-scan.hpp.
  */
 
 // syntactic constants
@@ -58,12 +72,39 @@ class Token {
      * A container for a TOKEN_TYPE and a std::string.
      * The std::string gives details about the token, e.g. the name of an
      * identifier.
+     * offset, line and column give the position of its first character in
+     * the input, line and column are counted from 1.
      */
   public:
-    Token() : str(), tok(TokenType::undefined) {}
+    Token() : str(), tok(TokenType::undefined), offset(0), line(0),
+        column(0) {}
     operator bool() const {return tok != TokenType::undefined;}
     std::string str;
     TokenType tok;
+    std::size_t offset;
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+class TokenView {
+    /**
+     * Non-owning counterpart of Token, returned by BufferTokenizer.
+     * str is a slice of the tokenized buffer and only valid as long as the
+     * buffer is, offset is the position of its first character in the buffer.
+     * line and column are counted from 1, see BufferTokenizer::set_position.
+     */
+  public:
+    TokenView() : str(), tok(TokenType::undefined), offset(0), line(0),
+        column(0) {}
+    TokenView(std::string_view str, TokenType tok, std::size_t offset,
+              std::uint32_t line = 0, std::uint32_t column = 0)
+        : str(str), tok(tok), offset(offset), line(line), column(column) {}
+    operator bool() const {return tok != TokenType::undefined;}
+    std::string_view str;
+    TokenType tok;
+    std::size_t offset;
+    std::uint32_t line;
+    std::uint32_t column;
 };
 
 template <typename SymbolClass = Symbol>
@@ -90,8 +131,9 @@ inline bool is_special_character(char c) noexcept {
 template <typename SymbolClass = Symbol>
 class Tokenizer {
   public:
+    typedef Token token_type;
     /** @param is std::istream to read from */
-    Tokenizer(std::istream& is) : is(is) {}
+    Tokenizer(std::istream& is) : is(is), pos(0), line(1), line_start(0) {}
     /**
      * gets the next token from the input stream by parsing one or more
      * characters from the stream
@@ -101,12 +143,20 @@ class Tokenizer {
         Token result = Token();
         char c = 0;
         unsigned short count = 0;
-        auto init_token = [&result, &c](TokenType tt) {
+        auto init_token = [this, &result, &c](TokenType tt) {
             result.tok = tt; result.str += c;
+            result.offset = pos - 1;
+            result.line = line;
+            result.column = pos - line_start;
         };
         auto update_token = [&result, &c]() {result.str += c;};
         bool comment = false;
         while(is.get(c)) {
+            ++pos;
+            if(c == '\n') {
+                ++line;
+                line_start = pos;
+            }
             if(count == 0) {
                 if(isspace(c)) continue;
                 else if(std::string s(1, c); is_reserved(s)) {
@@ -186,6 +236,7 @@ class Tokenizer {
 		    // of a new token, therefore we put it back and
 		    // return the current accumulator
                     is.unget();
+                    --pos;
                     break;
                 }
                 else {
@@ -224,11 +275,288 @@ class Tokenizer {
 	// deletes symbol from the reserved symbols
         reserved_symbols.erase(symbol);
     }
+    void set_position(std::uint32_t line, std::uint32_t column) noexcept {
+	/**
+	 * sets line and column of the next character of the stream, e.g. if
+	 * the stream starts in the middle of a file. Offsets stay relative to
+	 * the start of the stream.
+	 */
+        this->line = line;
+        // may wrap around, columns are computed modulo 2^n as well
+        line_start = pos - (column - 1);
+    }
   private:
     inline bool is_reserved(const std::string& str) {
         return reserved_symbols.find(str) != reserved_symbols.end();
     }
     std::istream& is;
+    // position of the next character, and the offset where its line starts
+    std::size_t pos;
+    std::uint32_t line;
+    std::size_t line_start;
+    std::unordered_map<std::string, std::function<void()>>
+        reserved_symbols;
+};
+
+
+/**
+ * classes of characters as seen by the first character of a token
+ */
+enum class CharClass : unsigned char {
+    invalid,
+    space,
+    lower,
+    upper,
+    digit,
+    comment,
+    special
+};
+
+struct CharInfo {
+    /**
+     * entry of the character table: the class of a character and, for
+     * special characters, the TokenType they start
+     */
+    CharClass cls;
+    TokenType tok;
+};
+
+template <typename SymbolClass = Symbol>
+constexpr std::array<CharInfo, 256> make_char_table() {
+    /**
+     * builds a flat lookup table with one entry per byte from SymbolClass,
+     * so that the tokenizer needs no chain of comparisons per character
+     */
+    std::array<CharInfo, 256> t{};
+    for(auto& e: t) e = {CharClass::invalid, TokenType::undefined};
+    for(char c: {' ', '\t', '\n', '\v', '\f', '\r'})
+        t[static_cast<unsigned char>(c)] = {CharClass::space,
+                                             TokenType::undefined};
+    for(int c = 'a'; c <= 'z'; ++c)
+        t[c] = {CharClass::lower, TokenType::identifier};
+    for(int c = 'A'; c <= 'Z'; ++c)
+        t[c] = {CharClass::upper, TokenType::name};
+    for(int c = '0'; c <= '9'; ++c)
+        t[c] = {CharClass::digit, TokenType::literal};
+    // special characters are entered last, so a SymbolClass that uses
+    // e.g. '\n' as separator takes precedence over whitespace
+    const std::pair<SymbolClass, TokenType> specials[] = {
+        {SymbolClass::lambda, TokenType::lambda},
+        {SymbolClass::body_start, TokenType::body_start},
+        {SymbolClass::bracket_open, TokenType::bracket_open},
+        {SymbolClass::bracket_close, TokenType::bracket_close},
+        {SymbolClass::separator, TokenType::separator},
+        {SymbolClass::assignment, TokenType::assignment},
+        {SymbolClass::conversion_end, TokenType::conv_end},
+        {SymbolClass::name_definition, TokenType::name_define}
+    };
+    for(const auto& sp: specials)
+        t[static_cast<unsigned char>(sp.first)] = {CharClass::special,
+                                                   sp.second};
+    t[static_cast<unsigned char>(SymbolClass::comment)] =
+        {CharClass::comment, TokenType::undefined};
+    return t;
+}
+
+template <typename SymbolClass = Symbol>
+struct CharTable {
+    static constexpr std::array<CharInfo, 256> table =
+        make_char_table<SymbolClass>();
+};
+
+template <typename SymbolClass = Symbol>
+class BufferTokenizer {
+    /**
+     * Tokenizer over a contiguous buffer. Accepts the same language and
+     * supports the same reserved-symbol mechanism as Tokenizer, but returns
+     * TokenViews into the buffer instead of copying every character.
+     * The buffer must outlive the tokenizer and all TokenViews it returned.
+     */
+  public:
+    typedef TokenView token_type;
+    /** @param buf buffer to read from */
+    BufferTokenizer(std::string_view buf) : buf(buf), pos(0), line(1),
+        line_start(0), counted(0), first_column(1), reserved_chars(),
+        reserved_words(), reserved_symbols() {}
+    /**
+     * gets the next token from the buffer
+     * @return TokenView-object, empty at the end of the buffer or if a
+     * reserved symbol has been encountered
+     */
+    TokenView get() {
+        const auto& table = CharTable<SymbolClass>::table;
+        const std::size_t size = buf.size();
+        while(pos < size) {
+            const auto c = static_cast<unsigned char>(buf[pos]);
+            const auto& entry = table[c];
+            if(entry.cls == CharClass::space) {
+                pos = skip<CharRun::space>(pos + 1);
+                continue;
+            }
+            if(reserved_chars[c]) {
+                ++pos;
+                reserved_symbols[std::string(1, c)]();
+                return TokenView();
+            }
+            const std::size_t start = pos;
+            switch(entry.cls) {
+                case CharClass::comment: {
+                    // everything up to and including the next newline
+                    auto nl = buf.find('\n', pos);
+                    pos = nl == std::string_view::npos ? size : nl + 1;
+                    continue;
+                }
+                case CharClass::special:
+                    ++pos;
+                    return make_token(buf.substr(start, 1), entry.tok, start);
+                case CharClass::lower:
+                case CharClass::upper:
+                    pos = skip<CharRun::letter>(pos + 1);
+                    return finish_word(start, entry.tok);
+                case CharClass::digit:
+                    pos = skip<CharRun::digit>(pos + 1);
+                    check_boundary();
+                    return make_token(buf.substr(start, pos - start),
+                                      TokenType::literal, start);
+                default:
+                    throw SyntaxException();
+            }
+        }
+        return TokenView();
+    }
+    void register_symbol(std::string symbol,
+                         std::function<void()> func) {
+        /**
+         * registers symbol with the reserved-symbol mechanism, see
+         * Tokenizer::register_symbol
+         */
+        if(!(islower(symbol[0]) || symbol.size() == 1))
+            throw InvalidReservedSymbol(
+                    "Only lowercase words or single characters may be reserved"
+                    );
+        if(symbol.size() == 1)
+            reserved_chars[static_cast<unsigned char>(symbol[0])] = true;
+        else if(std::find(reserved_words.begin(), reserved_words.end(),
+                          symbol) == reserved_words.end())
+            reserved_words.push_back(symbol);
+        reserved_symbols[symbol] = func;
+    }
+    void unregister_symbol(std::string symbol) {
+        // deletes symbol from the reserved symbols
+        if(symbol.size() == 1)
+            reserved_chars[static_cast<unsigned char>(symbol[0])] = false;
+        reserved_words.erase(std::remove(reserved_words.begin(),
+                                         reserved_words.end(), symbol),
+                             reserved_words.end());
+        reserved_symbols.erase(symbol);
+    }
+    /** @return current read position in the buffer */
+    std::size_t offset() const noexcept {
+        return pos;
+    }
+    void set_position(std::uint32_t line, std::uint32_t column) noexcept {
+        /**
+         * sets line and column of the first character of the buffer, e.g.
+         * if the buffer is a slice of a file. Offsets stay relative to the
+         * buffer.
+         */
+        this->line = line;
+        first_column = column;
+    }
+  private:
+    TokenView make_token(std::string_view str, TokenType tt,
+                         std::size_t start) {
+        // lines are counted lazily up to the start of each token, so the
+        // scanning loops do not have to look for newlines
+        for(auto nl = buf.find('\n', counted); nl < start;
+            nl = buf.find('\n', nl + 1)) {
+            ++line;
+            line_start = nl + 1;
+            first_column = 1;
+        }
+        counted = start;
+        return TokenView(str, tt, start, line,
+                         start - line_start + first_column);
+    }
+    static constexpr bool is_letter(CharClass cls) noexcept {
+        return cls == CharClass::lower || cls == CharClass::upper;
+    }
+    template <CharRun run>
+    static constexpr bool in_run(CharClass cls) noexcept {
+        switch(run) {
+            case CharRun::space:
+                return cls == CharClass::space;
+            case CharRun::letter:
+                return is_letter(cls);
+            case CharRun::digit:
+                break;
+        }
+        return cls == CharClass::digit;
+    }
+    template <CharRun run>
+    static constexpr bool scan_agrees() noexcept {
+        // CharScan has fixed classes, a SymbolClass may e.g. use '\n' as a
+        // special character
+        for(int c = 0; c < 256; ++c)
+            if(CharScan::is<run>(c) !=
+               in_run<run>(CharTable<SymbolClass>::table[c].cls))
+                return false;
+        return true;
+    }
+    template <CharRun run>
+    std::size_t skip(std::size_t from) const noexcept {
+        /**
+         * @return end of the run of characters of class run at from
+         */
+        if constexpr(scan_agrees<run>()) {
+            return CharScan::skip<run>(buf.data() + from,
+                                       buf.data() + buf.size()) - buf.data();
+        }
+        else {
+            while(from < buf.size() && in_run<run>(CharTable<SymbolClass>::
+                    table[static_cast<unsigned char>(buf[from])].cls))
+                ++from;
+            return from;
+        }
+    }
+    void check_boundary() const {
+        // a word or literal has to be followed by whitespace, a special
+        // character or the end of the buffer
+        if(pos == buf.size()) return;
+        auto cls = CharTable<SymbolClass>::table[
+            static_cast<unsigned char>(buf[pos])].cls;
+        if(cls != CharClass::space && cls != CharClass::special
+           && cls != CharClass::comment)
+            throw SyntaxException();
+    }
+    TokenView finish_word(std::size_t start, TokenType tt) {
+        check_boundary();
+        std::string_view word = buf.substr(start, pos - start);
+        if(tt == TokenType::identifier) {
+            // reserved symbol hook, see Tokenizer::get
+            for(const auto& w: reserved_words) {
+                if(w == word) {
+                    reserved_symbols[w]();
+                    return TokenView();
+                }
+            }
+            // true and false are literals
+            if(word == "true" || word == "false")
+                tt = TokenType::literal;
+        }
+        return make_token(word, tt, start);
+    }
+    std::string_view buf;
+    std::size_t pos;
+    // line of the last token and offset where that line starts, newlines
+    // before counted have been counted
+    std::uint32_t line;
+    std::size_t line_start;
+    std::size_t counted;
+    // column of line_start, only different from 1 on the first line
+    std::uint32_t first_column;
+    std::array<bool, 256> reserved_chars;
+    std::vector<std::string> reserved_words;
     std::unordered_map<std::string, std::function<void()>>
         reserved_symbols;
 };
@@ -1,5 +1,18 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include "lib/checkpoint.hpp"
+#include "lib/compactor.hpp"
+#include "lib/result-cache.hpp"
 #include "lib/lambda-syntax.hpp"
+#include "lib/printer.hpp"
+#include "lib/profiler.hpp"
+#include "lib/reducer.hpp"
+#include "lib/reduction.hpp"
+#include "lib/script-loader.hpp"
+#include "lib/serialization.hpp"
 
 #ifndef MAX_ITER
 #define MAX_ITER 1000
@@ -26,17 +39,212 @@ void help() {
     std::cout << "Examples:" << std::endl;
     std::cout << "  \\ x . x;" << std::endl;
     std::cout << "  (\\ x . x) y >;" << std::endl;
+    std::cout << "  (\\ x . x) y > cbv;" << std::endl;
     std::cout << "  'ID' = \\x . x;" << std::endl;
+    std::cout << R"("stats" shows statistics of the last evaluation.)"
+              << std::endl;
+    std::cout << R"("profile" shows its cost per definition, if the REPL )"
+                 R"(was started with "--profile FILE".)" << std::endl;
+    std::cout << R"("heap" shows statistics of the compaction of terms.)"
+              << std::endl;
+    std::cout << R"("cache" shows statistics of the result cache, if the )"
+                 R"(REPL was started with "--cache DIR".)" << std::endl;
+}
+
+bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+        str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void write_profile(const Profile& profile, const std::string& path) {
+    /**
+     * the format is chosen by the extension of path: ".folded" for folded
+     * stacks, ".speedscope.json" for speedscope, Chrome trace otherwise
+     */
+    std::ofstream out(path);
+    if(!out) {
+        std::cout << "Could not write profile: " << path << std::endl;
+        return;
+    }
+    if(ends_with(path, ".folded")) profile.write_folded(out);
+    else if(ends_with(path, ".speedscope.json")) profile.write_speedscope(out);
+    else profile.write_chrome_trace(out);
+}
+
+Command with_checkpoints(const Command& com,
+                         const std::shared_ptr<Checkpointer>& checkpointer) {
+    /**
+     * @return com with a copy of its beta reduction that saves checkpoints
+     */
+    auto beta = std::dynamic_pointer_cast<BetaReduction>(com.c);
+    if(!beta || !checkpointer) return com;
+    auto copy = std::make_shared<BetaReduction>(*beta);
+    copy->checkpointer = checkpointer;
+    return Command(com.ex, copy);
 }
 
-int main() {
+Expression_ptr trace(const Command& com, const PrintOptions& options,
+                     ReductionStats& stats) {
+    /**
+     * executes com, printing every intermediate term of a beta reduction
+     * with its step number. Only the steps are counted in stats.
+     */
+    auto beta = std::dynamic_pointer_cast<BetaReduction>(com.c);
+    if(!beta) return com.execute(stats);
+    Reducer reducer(com.ex, beta->strategy);
+    for(const Step& step: reducer) {
+        stats.beta_steps = step.index;
+        std::cout << step.index << ": ";
+        print_expression(std::cout, *step.term, options);
+        std::cout << std::endl;
+        if(step.index == beta->max_iter) throw MaxIterationsExceeded();
+        if(step.index == beta->num_steps) break;
+    }
+    return reducer.term();
+}
+
+int main(int argc, char** argv) {
     Parser parser(std::cin, MAX_ITER);
+    PrintOptions print_options;
+    // every command line argument is a script, e.g. a library of
+    // definitions, that is loaded before the first prompt.
+    // "--snapshot FILE" loads a snapshot built by lambda-snapshot instead,
+    // "--max-output BYTES" cuts results off after BYTES bytes, "--share"
+    // writes shared subterms of results only once and "--profile FILE"
+    // writes a profile of every evaluation to FILE (see write_profile),
+    // "--trace" prints every step of beta reductions (see trace),
+    // "--compact-min BYTES" and "--compact-growth FACTOR" set when the
+    // terms of the session are compacted (see CompactionPolicy),
+    // "--checkpoint FILE" saves the state of beta reductions to FILE every
+    // "--checkpoint-every STEPS" steps and "--resume FILE" finishes the
+    // reduction saved in FILE after loading the scripts (see checkpoint.hpp),
+    // "--cache DIR" keeps the results of beta reductions in DIR, which holds
+    // at most "--cache-size BYTES" bytes (see result-cache.hpp)
+    std::string profile_path;
+    bool tracing = false;
+    CompactionPolicy compaction;
+    std::string checkpoint_path;
+    unsigned long checkpoint_steps = 1000000;
+    std::string resume_path;
+    std::string cache_path;
+    std::uintmax_t cache_size = ResultCache::default_max_bytes;
+    // origins are only needed by the profiler, and are kept until exit,
+    // so scripts given before "--profile" are parsed with them as well
+    bool profiling = std::find(argv + 1, argv + argc,
+                               std::string("--profile")) != argv + argc;
+    parser.track_origins(profiling);
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if(arg == "--snapshot" && i + 1 < argc)
+                load_snapshot(parser.program, argv[++i]);
+            else if(arg == "--max-output" && i + 1 < argc)
+                print_options.max_bytes = std::stoul(argv[++i]);
+            else if(arg == "--share")
+                print_options.share = true;
+            else if(arg == "--profile" && i + 1 < argc)
+                profile_path = argv[++i];
+            else if(arg == "--trace")
+                tracing = true;
+            else if(arg == "--compact-min" && i + 1 < argc)
+                compaction.min_bytes = std::stoul(argv[++i]);
+            else if(arg == "--compact-growth" && i + 1 < argc)
+                compaction.growth = std::stod(argv[++i]);
+            else if(arg == "--checkpoint" && i + 1 < argc)
+                checkpoint_path = argv[++i];
+            else if(arg == "--checkpoint-every" && i + 1 < argc)
+                checkpoint_steps = std::stoul(argv[++i]);
+            else if(arg == "--resume" && i + 1 < argc)
+                resume_path = argv[++i];
+            else if(arg == "--cache" && i + 1 < argc)
+                cache_path = argv[++i];
+            else if(arg == "--cache-size" && i + 1 < argc)
+                cache_size = std::stoull(argv[++i]);
+            else
+                load_script_file(parser.program, arg, 0, MAX_ITER,
+                                 profiling);
+        }
+        catch (std::exception& e) {
+            std::cout << argv[i] << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::shared_ptr<ResultCache> cache;
+    if(!cache_path.empty()) {
+        try {
+            cache = std::make_shared<ResultCache>(cache_path, cache_size);
+        }
+        catch (std::exception& e) {
+            std::cout << cache_path << ": " << e.what() << std::endl;
+            return 1;
+        }
+        Command::results = cache;
+    }
+    std::shared_ptr<Checkpointer> checkpointer;
+    if(!checkpoint_path.empty()) {
+        // checkpoints are written next to the file first, see
+        // save_checkpoint, so that has to be possible
+        std::string tmp = checkpoint_path + ".tmp";
+        if(!std::ofstream(tmp)) {
+            std::cout << checkpoint_path << ": Could not open file: " << tmp
+                      << std::endl;
+            return 1;
+        }
+        std::remove(tmp.c_str());
+        checkpointer = std::make_shared<FileCheckpointer>(checkpoint_path,
+                                                          checkpoint_steps);
+    }
+    if(!resume_path.empty()) {
+        try {
+            Checkpoint checkpoint = load_checkpoint(resume_path,
+                                                    parser.program);
+            checkpoint.reduction->checkpointer = checkpointer;
+            Expression_ptr ex = checkpoint.resume();
+            parser.program["Ans"] = Command(ex,
+                                            std::make_shared<Conversion>());
+            print_expression(std::cout, *ex, print_options);
+            std::cout << std::endl;
+        }
+        catch (MaxIterationsExceeded&) {
+            std::cout << "Error: Maximum iterations exceeded. "
+                         "Expression does not seem to have a normal form."
+                         << std::endl;
+        }
+        catch (std::exception& e) {
+            std::cout << resume_path << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
     std::cout << "This is a REPL for lambda expressions." << std::endl;
     std::cout << "To exit, type \"exit\"." << std::endl;
     std::cout << "For help, type \"?\"." << std::endl;
     parser.register_symbol("?", help);
     parser.register_symbol("exit", []() {exit(0);});
+    ReductionStats last_stats;
+    parser.register_symbol("stats", [&last_stats]() {
+        std::cout << last_stats << std::endl;
+    });
+    Profile last_profile;
+    parser.register_symbol("profile", [&]() {
+        if(profile_path.empty())
+            std::cout << "Profiling is off, start with --profile FILE."
+                      << std::endl;
+        else std::cout << last_profile << std::endl;
+    });
+    Compactor compactor(compaction);
+    parser.register_symbol("heap", [&compactor]() {
+        std::cout << compactor.get_stats() << std::endl;
+    });
+    parser.register_symbol("cache", [&cache]() {
+        if(!cache)
+            std::cout << "The result cache is off, start with --cache DIR."
+                      << std::endl;
+        else std::cout << cache->get_stats() << std::endl;
+    });
+    parser.set_source("<stdin>");
     while(true) {
+        // between statements, the program holds all terms of the session
+        compactor.collect(parser.program);
         std::cout << ">> ";
         try {
             Program p = parser.statement();
@@ -46,10 +254,29 @@ int main() {
                 continue;
             }
             auto com = p.last_command();
-            auto ex = com.execute();
+            Command run = with_checkpoints(com, checkpointer);
+            last_stats = ReductionStats();
+            Expression_ptr ex;
+            if(tracing) ex = trace(com, print_options, last_stats);
+            else if(profile_path.empty()) ex = run.execute(last_stats);
+            else {
+                last_profile = Profile();
+                try {
+                    ex = run.execute(last_profile);
+                }
+                catch (MaxIterationsExceeded&) {
+                    // the profile shows where a divergent term spends its time
+                    last_stats = last_profile.stats;
+                    write_profile(last_profile, profile_path);
+                    throw;
+                }
+                last_stats = last_profile.stats;
+                write_profile(last_profile, profile_path);
+            }
 	    // register last command as "Ans"
             parser.program["Ans"] = com;
-            std::cout << *ex << std::endl;
+            print_expression(std::cout, *ex, print_options);
+            std::cout << std::endl;
         }
         catch (SyntaxException& e) {
             std::cout << e.what() << std::endl;
@@ -61,5 +288,10 @@ int main() {
                          << std::endl;
             flush();
         }
+        catch (FileError& e) {
+            // e.g. the checkpoint could not be written, the session goes on
+            std::cout << "Error: " << e.what() << std::endl;
+            flush();
+        }
     }
 }
@@ -0,0 +1,29 @@
+#include <iostream>
+#include "lib/script-loader.hpp"
+#include "lib/serialization.hpp"
+
+#ifndef MAX_ITER
+#define MAX_ITER 1000
+#endif
+
+/**
+ * compiles scripts, e.g. a prelude of definitions, into a snapshot that the
+ * REPL can load with --snapshot, see save_snapshot in serialization.hpp
+ */
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        std::cerr << "USAGE: " << argv[0] << " <snapshot> <script>..."
+                  << std::endl;
+        return 2;
+    }
+    Program program;
+    try {
+        for(int i = 2; i < argc; ++i)
+            load_script_file(program, argv[i], 0, MAX_ITER);
+        save_snapshot(program, argv[1]);
+    }
+    catch (LambdaException& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
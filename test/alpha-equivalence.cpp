@@ -0,0 +1,127 @@
+#include <unordered_set>
+#include "gtest/gtest.h"
+#include "../src/lib/alpha-equivalence.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+bool equivalent(const string& a, const string& b) {
+    return alpha_equivalent(*parse_term(a), *parse_term(b));
+}
+
+TEST(ALPHA, renamed_binders) {
+    ASSERT_TRUE(equivalent("\\ x . x", "\\ y . y"));
+    ASSERT_TRUE(equivalent("\\ f . \\ x . (f) (f) x",
+                           "\\ g . \\ y . (g) (g) y"));
+    ASSERT_EQ(alpha_hash(*parse_term("\\ f . \\ x . (f) x")),
+              alpha_hash(*parse_term("\\ a . \\ b . (a) b")));
+}
+
+TEST(ALPHA, different_terms) {
+    ASSERT_FALSE(equivalent("\\ x . \\ y . x", "\\ x . \\ y . y"));
+    ASSERT_FALSE(equivalent("\\ x . (x) x", "\\ x . x"));
+    ASSERT_FALSE(equivalent("\\ x . x", "x"));
+    ASSERT_FALSE(equivalent("\\ x . (x) y", "\\ x . (y) x"));
+}
+
+TEST(ALPHA, free_variables) {
+    ASSERT_TRUE(equivalent("(x) y", "(x) y"));
+    ASSERT_FALSE(equivalent("(x) y", "(x) z"));
+    ASSERT_FALSE(equivalent("\\ x . y", "\\ x . z"));
+    // a free variable is not a bound one of the same name
+    ASSERT_FALSE(equivalent("\\ y . y", "\\ x . y"));
+}
+
+TEST(ALPHA, open_subterms) {
+    // the bodies refer to the lambdas around them
+    auto a = parse_term("\\ x . \\ y . x");
+    auto b = parse_term("\\ x . \\ y . x");
+    auto body_a = node_cast<Lambda>(a.get())->get_body();
+    auto body_b = node_cast<Lambda>(b.get())->get_body();
+    ASSERT_TRUE(alpha_equivalent(*body_a, *body_a));
+    ASSERT_FALSE(alpha_equivalent(*body_a, *body_b));
+    ASSERT_EQ(body_a->cached_hash(), 0u);
+    alpha_hash(*a);
+    ASSERT_NE(a->cached_hash(), 0u);
+    // caching the root does not cache subterms that depend on it
+    ASSERT_EQ(body_a->cached_hash(), 0u);
+}
+
+TEST(ALPHA, shared_subterms) {
+    // the same node occurs under different numbers of lambdas
+    auto x = make_node<Variable>("x", true);
+    auto y = make_node<Variable>("y", true);
+    Expression_ptr shared = make_node<Application>(x, x);
+    auto a = make_node<Lambda>(x, make_node<Application>(
+        shared, make_node<Lambda>(y, shared)));
+    auto b = make_node<Lambda>(x, make_node<Application>(
+        shared, make_node<Lambda>(y, make_node<Application>(y, y))));
+    ASSERT_FALSE(alpha_equivalent(*a, *b));
+    auto c = parse_term("\\ z . ((z) z) \\ w . (z) z");
+    ASSERT_TRUE(alpha_equivalent(*a, *c));
+}
+
+TEST(ALPHA, containers) {
+    unordered_set<Expression_ptr, AlphaHash, AlphaEqual> terms;
+    terms.insert(parse_term("\\ x . x"));
+    terms.insert(parse_term("\\ y . y"));
+    terms.insert(parse_term("\\ x . \\ y . x"));
+    terms.insert(parse_term("\\ a . \\ b . a"));
+    terms.insert(parse_term("\\ a . \\ b . b"));
+    ASSERT_EQ(terms.size(), 3u);
+}
+
+Expression_ptr nested_lambdas(int depth) {
+    // \ x . \ x . ... \ x . x, where x is bound by the outermost lambda
+    auto outer = make_node<Variable>("x", true);
+    Expression_ptr ex = outer;
+    for(int i = 1; i < depth; ++i)
+        ex = make_node<Lambda>(make_node<Variable>("x", true), ex);
+    return make_node<Lambda>(outer, ex);
+}
+
+TEST(ALPHA, deep_terms) {
+    ASSERT_TRUE(alpha_equivalent(*nested_lambdas(5000),
+                                 *nested_lambdas(5000)));
+    ASSERT_FALSE(alpha_equivalent(*nested_lambdas(5000),
+                                  *nested_lambdas(4999)));
+}
+
+TEST(ALPHA, fixpoint_detection) {
+    const string omega = "(\\ w . (w) w) \\ w . (w) w";
+    ReductionStats stats;
+    BetaReduction unbounded(0, 0);
+    ASSERT_THROW(unbounded.execute(parse_term(omega), stats),
+                 MaxIterationsExceeded);
+    // the cycle is found long before max_iter
+    BetaReduction beta(1000, 1000);
+    ReductionStats bounded;
+    ASSERT_THROW(beta.execute(parse_term(omega), bounded),
+                 MaxIterationsExceeded);
+    ASSERT_LT(bounded.beta_steps, 10u);
+    // a fixed number of steps is still carried out
+    BetaReduction three(3, 1000);
+    ReductionStats steps;
+    three.execute(parse_term(omega), steps);
+    ASSERT_EQ(steps.beta_steps, 3u);
+}
+
+TEST(ALPHA, references) {
+    string input = "'ID' = \\ x . x; (ID) ID;";
+    BufferParser p(input);
+    p.statement();
+    auto app = node_cast<Application>(
+        p.statement().last_command().ex.get());
+    const Expression& ref = *app->get_function();
+    ASSERT_TRUE(alpha_equivalent(ref, *app->get_argument()));
+    // a name is not its value, and comparing does not resolve it
+    ASSERT_FALSE(alpha_equivalent(ref, *parse_term("\\ x . x")));
+    ASSERT_FALSE(node_cast<Reference>(&ref)->is_resolved());
+    // the cycle of (W) W is found without expanding W
+    string cycle = "'W' = \\ w . (w) w; (W) W;";
+    BufferParser q(cycle);
+    q.statement();
+    ASSERT_THROW(BetaReduction(0, 0).execute(q.statement().last_command().ex),
+                 MaxIterationsExceeded);
+}
@@ -0,0 +1,139 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "gtest/gtest.h"
+#include "../src/lib/checkpoint.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+struct Crash {};
+
+class CrashingCheckpointer : public Checkpointer {
+    /**
+     * saves every steps steps and crashes after saving crash_after times
+     */
+  public:
+    CrashingCheckpointer(const string& path, unsigned long steps,
+                         unsigned long crash_after)
+        : file(path, steps), crash_after(crash_after) {}
+    bool due(unsigned long steps) override {
+        return file.due(steps);
+    }
+    void save(const BetaReduction& beta,
+              const ReductionState& state) override {
+        file.save(beta, state);
+        if(file.saved() == crash_after) throw Crash();
+    }
+    FileCheckpointer file;
+    unsigned long crash_after;
+};
+
+class CheckpointTest : public ::testing::Test {
+  protected:
+    CheckpointTest() : is(), p(is, 100000), path("checkpoint-test.lccp") {}
+    ~CheckpointTest() {
+        remove(path.c_str());
+    }
+    Program define(const string& statement) {
+        is << statement;
+        return p.statement();
+    }
+    shared_ptr<BetaReduction> crash_in(const Command& com,
+                                       unsigned long steps,
+                                       unsigned long crash_after) {
+        auto beta = make_shared<BetaReduction>(
+            *dynamic_pointer_cast<BetaReduction>(com.c));
+        beta->checkpointer = make_shared<CrashingCheckpointer>(
+            path, steps, crash_after);
+        return beta;
+    }
+    stringstream is;
+    Parser p;
+    string path;
+};
+
+TEST_F(CheckpointTest, ResumeEqualsUninterruptedRun) {
+    define("'MUL' = \\ m . \\ n . \\ f . (m) (n) f;");
+    Program program = define("((MUL) 6) ((MUL) 7) 3 >;");
+    Command com = program.last_command();
+    ReductionStats whole;
+    string expected = to_string(com.execute(whole));
+    ASSERT_GT(whole.beta_steps, 20u);
+    ASSERT_THROW(crash_in(com, 5, 3)->execute(com.ex), Crash);
+    Checkpoint checkpoint = load_checkpoint(path, program);
+    ASSERT_EQ(checkpoint.state.steps, 15u);
+    ReductionStats rest;
+    ASSERT_EQ(to_string(checkpoint.resume(rest)), expected);
+    ASSERT_EQ(checkpoint.state.steps + rest.beta_steps, whole.beta_steps);
+}
+
+TEST_F(CheckpointTest, StrategyAndLimits) {
+    Program program = define(
+        "(\\ a . (\\ b . b) (\\ c . c) a) w 2 > cbv;");
+    Command com = program.last_command();
+    string expected = to_string(com.execute());
+    ASSERT_THROW(crash_in(com, 1, 1)->execute(com.ex), Crash);
+    Checkpoint checkpoint = load_checkpoint(path, program);
+    ASSERT_EQ(checkpoint.reduction->strategy, Strategy::call_by_value);
+    ASSERT_EQ(checkpoint.reduction->num_steps, 2u);
+    ASSERT_FALSE(checkpoint.reduction->checkpointer);
+    ASSERT_EQ(to_string(checkpoint.resume()), expected);
+}
+
+TEST_F(CheckpointTest, ReferencesStayUnresolved) {
+    define("'LOOP' = (\\ x . (x) x) \\ x . (x) x >;");
+    define("'K' = \\ a . \\ b . a;");
+    Program program = define("((K) k) LOOP >;");
+    Command com = program.last_command();
+    ASSERT_THROW(crash_in(com, 1, 1)->execute(com.ex), Crash);
+    Checkpoint checkpoint = load_checkpoint(path, program);
+    ASSERT_EQ(to_string(checkpoint.resume()), "k");
+    ASSERT_FALSE(node_cast<Reference>(program.reference("LOOP").get())
+                 ->is_resolved());
+    // the definitions are needed to resume
+    Program empty;
+    ASSERT_THROW(load_checkpoint(path, empty), SerializationError);
+}
+
+TEST_F(CheckpointTest, DivergenceIsDetectedAsBefore) {
+    // grows forever, so only max_iter ends it
+    Parser limited(is, 64);
+    is << "(\\ x . ((x) x) x) \\ x . ((x) x) x >;";
+    Command com = limited.statement().last_command();
+    ASSERT_THROW(com.execute(), MaxIterationsExceeded);
+    ASSERT_THROW(crash_in(com, 10, 2)->execute(com.ex), Crash);
+    Program program;
+    Checkpoint checkpoint = load_checkpoint(path, program);
+    ASSERT_EQ(checkpoint.state.steps, 20u);
+    ASSERT_EQ(checkpoint.state.next_check, 32u);
+    ASSERT_THROW(checkpoint.resume(), MaxIterationsExceeded);
+}
+
+TEST_F(CheckpointTest, UnwritablePath) {
+    Program program = define("((\\ x . \\ y . x) a) b >;");
+    Command com = program.last_command();
+    auto beta = make_shared<BetaReduction>(
+        *dynamic_pointer_cast<BetaReduction>(com.c));
+    beta->checkpointer = make_shared<FileCheckpointer>(
+        "does-not-exist/checkpoint.lccp", 1);
+    ASSERT_THROW(beta->execute(com.ex), FileError);
+    // the failed save leaves the command intact
+    ASSERT_EQ(to_string(com.execute()), "a");
+}
+
+TEST_F(CheckpointTest, Errors) {
+    Program program;
+    ASSERT_THROW(load_checkpoint("does-not-exist.lccp", program), FileError);
+    {
+        ofstream out(path, ios::binary);
+        out << "LCBF\x01Z";
+    }
+    ASSERT_THROW(load_checkpoint(path, program), SerializationError);
+    {
+        ofstream out(path, ios::binary);
+        out << "LCCP\x01\x05";
+    }
+    ASSERT_THROW(load_checkpoint(path, program), SerializationError);
+}
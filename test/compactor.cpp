@@ -0,0 +1,131 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/lib/compactor.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/node-allocator.hpp"
+#include "../src/lib/reducer.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+class CompactorTest : public ::testing::Test {
+  protected:
+    CompactorTest() : is(), p(is, 1000) {}
+    Program define(const string& statement) {
+        is << statement;
+        return p.statement();
+    }
+    stringstream is;
+    Parser p;
+};
+
+TEST_F(CompactorTest, RelocatesProgram) {
+    define("'ID' = \\ x . x;");
+    define("'K' = \\ x . \\ y . x;");
+    Program program = define("(ID) ID >;");
+    Expression_ptr id = program["ID"].ex;
+    Expression_ptr k = program["K"].ex;
+    Compactor compactor;
+    compactor.compact(program);
+    ASSERT_NE(program["ID"].ex, id);
+    ASSERT_EQ(to_string(program["ID"].ex), to_string(id));
+    ASSERT_EQ(to_string(program["K"].ex), to_string(k));
+    ASSERT_TRUE(alpha_equivalent(*program["K"].ex, *k));
+    // both uses still share one reference, which is the cached one
+    auto app = node_cast<Application>(program.last_command().ex.get());
+    ASSERT_TRUE(app);
+    ASSERT_EQ(app->get_function(), app->get_argument());
+    ASSERT_EQ(app->get_function(), program.reference("ID"));
+    ASSERT_EQ(to_string(program.last_command().execute()), "\\x . x");
+    ASSERT_EQ(compactor.get_stats().compactions, 1u);
+    ASSERT_GT(compactor.get_stats().nodes, 0u);
+}
+
+TEST_F(CompactorTest, References) {
+    define("'LOOP' = (\\ x . (x) x) \\ x . (x) x >;");
+    define("'IF' = \\ p . \\ a . \\ b . ((p) a) b;");
+    define("'ID' = \\ x . x >;");
+    Program program = define("(((IF) true) ID) LOOP >;");
+    ASSERT_EQ(to_string(program.last_command().execute()), "\\x . x");
+    Compactor compactor;
+    compactor.compact(program);
+    // resolved references keep their value, unresolved ones their command
+    auto id = node_cast<Reference>(program.reference("ID").get());
+    ASSERT_TRUE(id->is_resolved());
+    ASSERT_EQ(to_string(id->get_value()), "\\x . x");
+    auto loop = node_cast<Reference>(program.reference("LOOP").get());
+    ASSERT_FALSE(loop->is_resolved());
+    ASSERT_EQ(to_string(program.last_command().execute()), "\\x . x");
+    ASSERT_THROW(loop->get_value(), MaxIterationsExceeded);
+}
+
+TEST_F(CompactorTest, InFlightReduction) {
+    Program program = define("((\\ f . \\ x . (f) (f) (f) x) \\ y . y) z;");
+    Reducer reducer(program.last_command().ex);
+    reducer.advance(2);
+    Expression_ptr before = reducer.term();
+    Compactor compactor;
+    compactor.compact(program, {reducer.root()});
+    ASSERT_NE(reducer.term(), before);
+    ASSERT_EQ(to_string(reducer.term()), to_string(before));
+    before = nullptr;
+    while(reducer.advance()) {}
+    ASSERT_EQ(to_string(reducer.term()), "z");
+}
+
+TEST(COMPACTOR, releases_slabs) {
+    /**
+     * keeps every 64th of many nodes, so the slabs are mostly free but
+     * none is empty until the survivors are relocated
+     */
+    std::vector<Expression_ptr> kept;
+    {
+        std::vector<Expression_ptr> nodes;
+        for(int i = 0; i < 64 * 4096; ++i)
+            nodes.push_back(make_node<Variable>("x", false));
+        for(std::size_t i = 0; i < nodes.size(); i += 64)
+            kept.push_back(nodes[i]);
+    }
+    std::size_t before = NodePool::slab_bytes();
+    std::vector<Expression_ptr*> roots;
+    for(auto& ex: kept) roots.push_back(&ex);
+    Compactor compactor;
+    compactor.compact(roots);
+    const CompactionStats& stats = compactor.get_stats();
+    ASSERT_EQ(stats.nodes, kept.size());
+    ASSERT_GE(stats.live_bytes, kept.size() * sizeof(Variable));
+    ASSERT_GT(stats.released_bytes, 0u);
+    ASSERT_LT(NodePool::slab_bytes(), before / 2);
+    // the survivors are contiguous now, but for the ends of slabs
+    std::size_t adjacent = 0;
+    for(std::size_t i = 1; i < kept.size(); ++i) {
+        auto gap = reinterpret_cast<const char*>(kept[i].get())
+                   - reinterpret_cast<const char*>(kept[i - 1].get());
+        if(gap > 0 && gap < 2 * static_cast<std::ptrdiff_t>(sizeof(Variable)))
+            ++adjacent;
+    }
+    ASSERT_GT(adjacent, kept.size() - 16);
+    for(auto& ex: kept) ASSERT_EQ(to_string(ex), "x");
+}
+
+TEST(COMPACTOR, triggers) {
+    Program program;
+    CompactionPolicy never;
+    never.min_bytes = static_cast<std::size_t>(-1);
+    Compactor lazy(never);
+    ASSERT_FALSE(lazy.due());
+    ASSERT_FALSE(lazy.collect(program));
+    ASSERT_EQ(lazy.get_stats().compactions, 0u);
+    CompactionPolicy always;
+    always.min_bytes = 0;
+    always.growth = 0;
+    Compactor eager(always);
+    ASSERT_TRUE(eager.collect(program));
+    ASSERT_TRUE(eager.collect(program));
+    const CompactionStats& stats = eager.get_stats();
+    ASSERT_EQ(stats.compactions, 2u);
+    ASSERT_GE(stats.max_pause, stats.last_pause);
+    ASSERT_GE(stats.total_pause, stats.max_pause);
+}
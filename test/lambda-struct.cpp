@@ -6,17 +6,17 @@ using namespace std;
 inline vector<Variable_ptr> make_vars(vector<string> names, bool bound) {
     vector<Variable_ptr> res(names.size());
     for(unsigned int i = 0; i < names.size(); ++i) {
-        res[i] = make_shared<Variable>(names[i], bound);
+        res[i] = make_node<Variable>(names[i], bound);
     }
     return res;
 }
 
 TEST(BETA, simple_1) {
     // tests reduction of ( \x . x) hallo
-    Variable_ptr v1 = make_shared<Variable>("hallo", false);
-    Variable_ptr v2 = make_shared<Variable>("x", true);
-    Lambda_ptr l = make_shared<Lambda>(v2, v2);
-    Application_ptr a = make_shared<Application>(l, v1);
+    Variable_ptr v1 = make_node<Variable>("hallo", false);
+    Variable_ptr v2 = make_node<Variable>("x", true);
+    Lambda_ptr l = make_node<Lambda>(v2, v2);
+    Application_ptr a = make_node<Application>(l, v1);
     auto res = a->beta_reduce();
     stringstream ss;
     ss << *res;
@@ -27,11 +27,11 @@ TEST(BETA, simple_2) {
     // tests reduction of (\ x . (\ y . y a) b) c, which requires 2 steps
     auto bounds = make_vars({"x", "y"}, true);
     auto unbounds = make_vars({"a", "b", "c"}, false);
-    Application_ptr a1 = make_shared<Application>(bounds[1], unbounds[0]);
-    Lambda_ptr l1 = make_shared<Lambda>(bounds[1], a1);
-    Application_ptr a2 = make_shared<Application>(l1, unbounds[1]);
-    Lambda_ptr l2 = make_shared<Lambda>(bounds[0], a2);
-    Application_ptr out = make_shared<Application>(l2, unbounds[2]);
+    Application_ptr a1 = make_node<Application>(bounds[1], unbounds[0]);
+    Lambda_ptr l1 = make_node<Lambda>(bounds[1], a1);
+    Application_ptr a2 = make_node<Application>(l1, unbounds[1]);
+    Lambda_ptr l2 = make_node<Lambda>(bounds[0], a2);
+    Application_ptr out = make_node<Application>(l2, unbounds[2]);
     // first reduction
     auto res1 = out->beta_reduce();
     stringstream ss;
@@ -47,9 +47,9 @@ TEST(BETA, simple_2) {
 TEST(ALPHA, simple_1) {
     // lets rename the x in \ x . (\ z . z) x
     auto bounds = make_vars({"z", "x"}, true);
-    auto l1 = make_shared<Lambda>(bounds[0], bounds[0]);
-    auto a1 = make_shared<Application>(l1, bounds[1]);
-    auto l2 = make_shared<Lambda>(bounds[1], a1);
+    auto l1 = make_node<Lambda>(bounds[0], bounds[0]);
+    auto a1 = make_node<Application>(l1, bounds[1]);
+    auto l2 = make_node<Lambda>(bounds[1], a1);
     auto res = l2->alpha_convert("x", "y");
     stringstream ss;
     ss << *res;
@@ -59,14 +59,14 @@ TEST(BETA, conflicting_names) {
     auto bound = make_vars({"x", "y", "x", "x"}, true);
     auto unbound = make_vars({"b"}, false);
 
-    auto xy = make_shared<Application>(bound[2], bound[1]);
-    auto lx_xy = make_shared<Lambda>(bound[2], xy);
-    auto lx_ly = make_shared<Lambda>(bound[1], lx_xy);
-    auto a1 = make_shared<Application>(lx_ly, bound[0]);
-    auto id = make_shared<Lambda>(bound[3], bound[3]);
-    auto a2 = make_shared<Application>(a1, id);
-    auto lx_outer = make_shared<Lambda>(bound[0], a2);
-    auto outer = make_shared<Application>(lx_outer, unbound[0]);
+    auto xy = make_node<Application>(bound[2], bound[1]);
+    auto lx_xy = make_node<Lambda>(bound[2], xy);
+    auto lx_ly = make_node<Lambda>(bound[1], lx_xy);
+    auto a1 = make_node<Application>(lx_ly, bound[0]);
+    auto id = make_node<Lambda>(bound[3], bound[3]);
+    auto a2 = make_node<Application>(a1, id);
+    auto lx_outer = make_node<Lambda>(bound[0], a2);
+    auto outer = make_node<Application>(lx_outer, unbound[0]);
 
     cout << *outer << endl;
     auto res1 = outer->beta_reduce();
@@ -84,12 +84,12 @@ TEST(BETA, conflicting_names) {
 
 TEST(ALPHA, conflicting_names) {
     auto bound = make_vars({"x", "x", "y"}, true);
-    auto xy = make_shared<Application>(bound[2], bound[1]);
-    auto ly = make_shared<Lambda>(bound[2], xy);
-    auto lx = make_shared<Lambda>(bound[1], ly);
-    auto a1 = make_shared<Application>(lx, bound[0]);
-    auto a2 = make_shared<Application>(a1, bound[0]);
-    auto outer = make_shared<Lambda>(bound[0], a2);
+    auto xy = make_node<Application>(bound[2], bound[1]);
+    auto ly = make_node<Lambda>(bound[2], xy);
+    auto lx = make_node<Lambda>(bound[1], ly);
+    auto a1 = make_node<Application>(lx, bound[0]);
+    auto a2 = make_node<Application>(a1, bound[0]);
+    auto outer = make_node<Lambda>(bound[0], a2);
     cout << *outer << endl;
     auto res1 = outer->alpha_convert("x", "u");
     cout << *res1 << endl;
@@ -104,11 +104,11 @@ TEST(BETA, first_part_no_reduction) {
     // (g) ((\ x . (x) x) o) d
     auto bound = make_vars({"x"}, true);
     auto unbound = make_vars({"g", "o", "d"}, false);
-    auto a1 = make_shared<Application>(bound[0], bound[0]);
-    auto l1 = make_shared<Lambda>(bound[0], a1);
-    auto a2 = make_shared<Application>(l1, unbound[1]);
-    auto a3 = make_shared<Application>(a2, unbound[2]);
-    auto a4 = make_shared<Application>(unbound[0], a3);
+    auto a1 = make_node<Application>(bound[0], bound[0]);
+    auto l1 = make_node<Lambda>(bound[0], a1);
+    auto a2 = make_node<Application>(l1, unbound[1]);
+    auto a3 = make_node<Application>(a2, unbound[2]);
+    auto a4 = make_node<Application>(unbound[0], a3);
 
     auto res = a4->beta_reduce();
     stringstream ss;
@@ -120,13 +120,13 @@ TEST(BETA, NORMAL_ORDER) {
     // (\x . a) (\x . (x) x) \y.(y) y
     auto unbound = make_vars({"a"}, false);
     auto bound = make_vars({"x", "x", "y"}, true);
-    auto a1 = make_shared<Application>(bound[2], bound[2]);
-    auto l1 = make_shared<Lambda>(bound[2], a1);
-    auto a2 = make_shared<Application>(bound[1], bound[1]);
-    auto l2 = make_shared<Lambda>(bound[1], a2);
-    auto a3 = make_shared<Application>(l2, l1);
-    auto l3 = make_shared<Lambda>(bound[0], unbound[0]);
-    auto a4 = make_shared<Application>(l3, a3);
+    auto a1 = make_node<Application>(bound[2], bound[2]);
+    auto l1 = make_node<Lambda>(bound[2], a1);
+    auto a2 = make_node<Application>(bound[1], bound[1]);
+    auto l2 = make_node<Lambda>(bound[1], a2);
+    auto a3 = make_node<Application>(l2, l1);
+    auto l3 = make_node<Lambda>(bound[0], unbound[0]);
+    auto a4 = make_node<Application>(l3, a3);
 
     auto res = a4->beta_reduce();
     stringstream ss;
@@ -137,13 +137,13 @@ TEST(STRING_REPR, test1) {
     // (\x . a) (\x . (x) x) \y.(y) y
     auto unbound = make_vars({"a"}, false);
     auto bound = make_vars({"x", "x", "y"}, true);
-    auto a1 = make_shared<Application>(bound[2], bound[2]);
-    auto l1 = make_shared<Lambda>(bound[2], a1);
-    auto a2 = make_shared<Application>(bound[1], bound[1]);
-    auto l2 = make_shared<Lambda>(bound[1], a2);
-    auto a3 = make_shared<Application>(l2, l1);
-    auto l3 = make_shared<Lambda>(bound[0], unbound[0]);
-    auto a4 = make_shared<Application>(l3, a3);
+    auto a1 = make_node<Application>(bound[2], bound[2]);
+    auto l1 = make_node<Lambda>(bound[2], a1);
+    auto a2 = make_node<Application>(bound[1], bound[1]);
+    auto l2 = make_node<Lambda>(bound[1], a2);
+    auto a3 = make_node<Application>(l2, l1);
+    auto l3 = make_node<Lambda>(bound[0], unbound[0]);
+    auto a4 = make_node<Application>(l3, a3);
 
     stringstream ss;
     ss << *a4;
@@ -153,11 +153,11 @@ TEST(STRING_REPR, test1) {
 TEST(BETA, no_normal_form) {
     // (\ x . (x) x) \ y . (y) y
     auto bound = make_vars({"x", "y"}, true);
-    auto xx = make_shared<const Application>(bound[0], bound[0]);
-    auto yy = make_shared<const Application>(bound[1], bound[1]);
-    auto lx = make_shared<const Lambda>(bound[0], xx);
-    auto ly = make_shared<const Lambda>(bound[1], yy);
-    auto ap = make_shared<const Application>(lx, ly);
+    auto xx = make_node<Application>(bound[0], bound[0]);
+    auto yy = make_node<Application>(bound[1], bound[1]);
+    auto lx = make_node<Lambda>(bound[0], xx);
+    auto ly = make_node<Lambda>(bound[1], yy);
+    auto ap = make_node<Application>(lx, ly);
     for(char i = 0; i < 99; ++i) {
         auto ap_new = ap->beta_reduce();
         ASSERT_NE(ap_new, ap);
@@ -170,9 +170,9 @@ TEST(BETA, lambda) {
     // \ x . (\ y . x) a
     auto bound = make_vars({"x", "y"}, true);
     auto unbound = make_vars({"a"}, false);
-    auto inner = make_shared<Lambda>(bound[1], bound[0]);
-    auto app = make_shared<Application>(inner, unbound[0]);
-    auto outer = make_shared<Lambda>(bound[0], app);
+    auto inner = make_node<Lambda>(bound[1], bound[0]);
+    auto app = make_node<Application>(inner, unbound[0]);
+    auto outer = make_node<Lambda>(bound[0], app);
     auto res = outer->beta_reduce();
     stringstream ss;
     ss << *res;
@@ -183,8 +183,8 @@ TEST(ALPHA, name_clash) {
     // trying to rename x to y in \ x. (x) y
     auto bound = make_vars({"x"}, true);
     auto unbound = make_vars({"y"}, false);
-    auto xy = make_shared<Application>(bound[0], unbound[0]);
-    auto lx = make_shared<Lambda>(bound[0], xy);
+    auto xy = make_node<Application>(bound[0], unbound[0]);
+    auto lx = make_node<Lambda>(bound[0], xy);
     ASSERT_THROW(lx->alpha_convert("x", "y"), NameClash);
 }
 
@@ -192,8 +192,8 @@ TEST(ALPHA, name_clash_exception) {
     // trying to rename x to y in \ x. (x) y
     auto bound = make_vars({"x"}, true);
     auto unbound = make_vars({"y"}, false);
-    auto xy = make_shared<Application>(bound[0], unbound[0]);
-    auto lx = make_shared<Lambda>(bound[0], xy);
+    auto xy = make_node<Application>(bound[0], unbound[0]);
+    auto lx = make_node<Lambda>(bound[0], xy);
     try{
         lx->alpha_convert("x", "y");
         FAIL();
@@ -206,7 +206,48 @@ TEST(ALPHA, identity) {
     // trying to rename u to v in (x) y
     auto bound = make_vars({"x"}, true);
     auto unbound = make_vars({"y"}, false);
-    auto xy = make_shared<Application>(bound[0], unbound[0]);
+    auto xy = make_node<Application>(bound[0], unbound[0]);
     auto res = xy->alpha_convert("u", "v");
     ASSERT_EQ(xy, res);
 }
+
+TEST(KIND, tags) {
+    auto x = make_vars({"x"}, true)[0];
+    auto lx = make_node<Lambda>(x, x);
+    Expression_ptr app = make_node<Application>(lx, x);
+    ASSERT_EQ(x->get_kind(), NodeKind::variable);
+    ASSERT_EQ(lx->get_kind(), NodeKind::lambda);
+    ASSERT_EQ(app->get_kind(), NodeKind::application);
+    ASSERT_EQ(node_cast<Application>(app.get()), app.get());
+    ASSERT_EQ(node_cast<Lambda>(app.get()), nullptr);
+    ASSERT_EQ(node_cast<Variable>(static_cast<const Expression*>(nullptr)),
+              nullptr);
+}
+
+struct CountVisitor {
+    // a pass without virtual methods: counts nodes of a tree
+    std::size_t operator()(const Variable&) const {
+        return 1;
+    }
+    std::size_t operator()(const Lambda& l) const {
+        return 1 + visit(*l.get_head(), *this) + visit(*l.get_body(), *this);
+    }
+    std::size_t operator()(const Application& a) const {
+        return 1 + visit(*a.get_function(), *this) +
+            visit(*a.get_argument(), *this);
+    }
+    std::size_t operator()(const Reference&) const {
+        return 1;
+    }
+};
+
+TEST(KIND, visit) {
+    auto x = make_vars({"x"}, true)[0];
+    auto lx = make_node<Lambda>(x, make_node<Application>(x, x));
+    ASSERT_EQ(visit(*lx, CountVisitor()), 5u);
+    // generic visitors see the concrete class
+    auto name = visit(*x, [](const auto& node) {
+        return std::string(typeid(node).name());
+    });
+    ASSERT_EQ(name, typeid(Variable).name());
+}
@@ -14,7 +14,7 @@ class SyntaxTest : public ::testing::Test {
 
 TEST_F(SyntaxTest, VariableParses) {
     is << "x;";
-    auto result = std::dynamic_pointer_cast<const Variable>(
+    auto result = dynamic_pointer_cast<const Variable>(
             p.statement().last_command().execute()
             );
     ASSERT_EQ(result->get_name(), "x");
@@ -22,7 +22,7 @@ TEST_F(SyntaxTest, VariableParses) {
 
 TEST_F(SyntaxTest, LambdaParsesSimple) {
     is << "\\ x . x;";
-    auto result = std::dynamic_pointer_cast<const Lambda>(
+    auto result = dynamic_pointer_cast<const Lambda>(
             p.statement().last_command().execute()
             );
     os << *result;
@@ -31,7 +31,7 @@ TEST_F(SyntaxTest, LambdaParsesSimple) {
 
 TEST_F(SyntaxTest, ApplicationParsesSimple) {
     is << "(f) x;";
-    auto result = std::dynamic_pointer_cast<const Application>(
+    auto result = dynamic_pointer_cast<const Application>(
             p.statement().last_command().execute()
             );
     os << *result;
@@ -42,7 +42,7 @@ TEST_F(SyntaxTest, AssignmentParsesSimple) {
     is << "'A' = a;";
     auto prog = p.statement();
     ASSERT_TRUE(prog.contains("A"));
-    auto expr = std::dynamic_pointer_cast<const Variable>(
+    auto expr = dynamic_pointer_cast<const Variable>(
             prog["A"].execute()
             );
     ASSERT_EQ(expr->get_name(), "a");
@@ -253,4 +253,115 @@ TEST_F(SyntaxTest, beta_reduction_false) {
     auto res = p.statement().last_command().execute();
     os << *res;
     ASSERT_EQ("y", os.str());
-}
\ No newline at end of file
+}
+TEST(BufferSyntaxTest, ParsesStatements) {
+    std::string input = "'ID' = \\ x . x;\n# comment\n(ID) (\\y . y) a >;";
+    BufferParser p(input);
+    p.statement();
+    auto var = p.statement().last_command().execute();
+    std::stringstream os;
+    os << *var;
+    ASSERT_EQ(os.str(), "a");
+}
+
+TEST(BufferSyntaxTest, SyntaxError) {
+    std::string input = "'A' = =;";
+    BufferParser p(input);
+    ASSERT_THROW(p.statement(), SyntaxException);
+}
+
+TEST_F(SyntaxTest, Shadowing) {
+    is << "\\ x . (\\ x . (x) y) x;";
+    auto var = p.statement().last_command().execute();
+    auto outer = dynamic_pointer_cast<const Lambda>(var);
+    auto app = dynamic_pointer_cast<const Application>(outer->get_body());
+    auto inner = dynamic_pointer_cast<const Lambda>(app->get_function());
+    ASSERT_NE(inner->get_head(), outer->get_head());
+    ASSERT_EQ(app->get_argument(), outer->get_head());
+}
+
+TEST_F(SyntaxTest, BindingsResetAfterError) {
+    // the failed statement must not leave x bound
+    is << "\\ x . (x;";
+    ASSERT_THROW(p.statement(), SyntaxException);
+    is.clear();
+    is.str("x;");
+    auto var = dynamic_pointer_cast<const Variable>(
+            p.statement().last_command().execute()
+            );
+    ASSERT_FALSE(var->is_bound());
+}
+
+TEST_F(SyntaxTest, DeepNesting) {
+    // nesting depth is not limited by the call stack
+    const int depth = 5000;
+    for(int i = 0; i < depth; ++i) is << "(\\ x . ";
+    is << "x";
+    for(int i = 0; i < depth; ++i) is << ") y";
+    is << ";";
+    Expression_ptr ex = p.statement().last_command().execute();
+    for(int i = 0; i < depth; ++i) {
+        auto app = dynamic_pointer_cast<const Application>(ex);
+        ASSERT_TRUE(app);
+        ex = dynamic_pointer_cast<const Lambda>(
+                app->get_function())->get_body();
+    }
+    ASSERT_EQ(dynamic_pointer_cast<const Variable>(ex)->get_name(), "x");
+}
+
+TEST_F(SyntaxTest, SelfApplicationKeepsBindersApart) {
+    // PRED is substituted into a copy of itself, its binders must not be
+    // confused: 2 - 2 = 0
+    is << "'PRED' = \\ n . \\ f . \\ x . (((n) \\ g . \\ h . (h) (g) f) "
+          "\\ u . x) \\ u . u;";
+    p.statement();
+    is << "((\\ m . \\ n . ((n) PRED) m) 2) 2 >;";
+    auto var = p.statement().last_command().execute();
+    os << *var;
+    ASSERT_EQ(os.str(), "\\f . \\x . x");
+}
+
+TEST_F(SyntaxTest, NamesAreReferences) {
+    is << "'ID' = \\ x . x;";
+    p.statement();
+    is << "(ID) ID;";
+    auto app = node_cast<Application>(
+        p.statement().last_command().ex.get());
+    ASSERT_TRUE(app);
+    // both uses share one node, so the value is resolved at most once
+    auto ref = node_cast<Reference>(app->get_function().get());
+    ASSERT_TRUE(ref);
+    ASSERT_EQ(app->get_argument().get(), ref);
+    ASSERT_EQ(ref->get_name(), "ID");
+    ASSERT_FALSE(ref->is_resolved());
+}
+
+TEST_F(SyntaxTest, UntakenBranchIsNotEvaluated) {
+    // evaluating LOOP would throw MaxIterationsExceeded
+    is << "'LOOP' = (\\ x . (x) x) \\ x . (x) x >;";
+    p.statement();
+    is << "'IF' = \\ p . \\ a . \\ b . ((p) a) b;";
+    p.statement();
+    is << "'ID' = \\ x . x;";
+    p.statement();
+    is << "(((IF) true) ID) LOOP >;";
+    Program program = p.statement();
+    os << *program.last_command().execute();
+    ASSERT_EQ(os.str(), "\\x . x");
+    auto loop = node_cast<Reference>(program.reference("LOOP").get());
+    ASSERT_FALSE(loop->is_resolved());
+    ASSERT_TRUE(node_cast<Reference>(
+        program.reference("ID").get())->is_resolved());
+    is << "LOOP >;";
+    ASSERT_THROW(p.statement().last_command().execute(),
+                 MaxIterationsExceeded);
+}
+
+TEST_F(SyntaxTest, ReferenceSeesDefinitionAtParseTime) {
+    is << "'A' = a; 'B' = A; 'A' = b; (B) A >;";
+    p.statement();
+    p.statement();
+    p.statement();
+    os << *p.statement().last_command().execute();
+    ASSERT_EQ(os.str(), "(a) b");
+}
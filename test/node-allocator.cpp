@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/lib/node-allocator.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+
+TEST(NODE_ALLOCATOR, counts) {
+    MemoryStats before = node_memory();
+    {
+        auto v = make_node<Variable>("x", true);
+        auto l = make_node<Lambda>(v, v);
+        ASSERT_EQ(node_memory().allocations, before.allocations + 2);
+        ASSERT_GT(node_memory().live_bytes, before.live_bytes);
+        // shared_from_this still works with the pool allocator
+        ASSERT_EQ(l->shared_from_this(), l);
+    }
+    MemoryStats after = node_memory();
+    ASSERT_EQ(after.deallocations, before.deallocations + 2);
+    ASSERT_EQ(after.live_bytes, before.live_bytes);
+    ASSERT_EQ(after.bytes_freed - before.bytes_freed,
+              after.bytes_allocated - before.bytes_allocated);
+}
+
+TEST(NODE_ALLOCATOR, reuse) {
+    const void* first;
+    {
+        auto v = make_node<Variable>("x", false);
+        first = v.get();
+    }
+    auto v = make_node<Variable>("y", false);
+    ASSERT_EQ(static_cast<const void*>(v.get()), first);
+}
+
+TEST(NODE_ALLOCATOR, size_classes) {
+    for(std::size_t size: {1u, 16u, 17u, 100u, 256u, 257u, 4096u}) {
+        MemoryStats before = node_memory();
+        void* p = NodePool::allocate(size);
+        ASSERT_EQ(reinterpret_cast<std::uintptr_t>(p) %
+                  NodePool::granularity, 0u);
+        ASSERT_EQ(node_memory().bytes_allocated - before.bytes_allocated,
+                  size);
+        NodePool::deallocate(p, size);
+    }
+}
+
+TEST(NODE_ALLOCATOR, peak) {
+    reset_peak_node_memory();
+    MemoryStats before = node_memory();
+    {
+        std::vector<Variable_ptr> nodes;
+        for(int i = 0; i < 1000; ++i)
+            nodes.push_back(make_node<Variable>("x", false));
+    }
+    ASSERT_EQ(node_memory().live_bytes, before.live_bytes);
+    ASSERT_GE(node_memory().peak_bytes - before.live_bytes,
+              static_cast<std::ptrdiff_t>(1000 * sizeof(Variable)));
+}
+
+TEST(NODE_ALLOCATOR, threads) {
+    // nodes freed on another thread than the one that allocated them
+    std::vector<Expression_ptr> nodes;
+    std::thread producer([&nodes]() {
+        for(int i = 0; i < 10000; ++i)
+            nodes.push_back(make_node<Variable>("x", false));
+    });
+    producer.join();
+    MemoryStats before = node_memory();
+    nodes.clear();
+    ASSERT_EQ(node_memory().deallocations, before.deallocations + 10000);
+    // the blocks of the exited thread are available again
+    for(int i = 0; i < 100; ++i)
+        nodes.push_back(make_node<Variable>("y", false));
+}
+
+TEST(NODE_ALLOCATOR, reduction_stats) {
+    BufferParser p("(\\ x . (x) x) \\ y . (y) y 3>;");
+    auto com = p.statement().last_command();
+    ReductionStats stats;
+    com.execute(stats);
+    ASSERT_GT(stats.bytes_allocated, 0u);
+    ASSERT_LE(stats.peak_bytes, stats.bytes_allocated);
+}
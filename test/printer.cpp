@@ -0,0 +1,89 @@
+#include "gtest/gtest.h"
+#include "../src/lib/printer.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/script-loader.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+string print(const Expression_ptr& ex, const PrintOptions& options) {
+    stringstream ss;
+    print_expression(ss, *ex, options);
+    return ss.str();
+}
+
+TEST(PRINTER, default_matches_print) {
+    for(auto input: {"x;", "\\ x . x;", "(\\ x . (x) x) \\ y . (y) z;",
+                     "((a) b) (c) \\ d . (d) e;"}) {
+        auto ex = parse(input).execute();
+        stringstream expected;
+        ex->print(expected);
+        ASSERT_EQ(print(ex, PrintOptions()), expected.str());
+        stringstream ss;
+        ss << *ex;
+        ASSERT_EQ(ss.str(), expected.str());
+    }
+}
+
+TEST(PRINTER, max_bytes) {
+    auto ex = parse("\\ x . ((x) x) x;").execute();
+    PrintOptions options;
+    options.max_bytes = 8;
+    stringstream ss;
+    Printer printer(ss, options);
+    printer.print(*ex);
+    ASSERT_TRUE(printer.was_truncated());
+    ASSERT_EQ(ss.str(), "\\x . ((x...");
+
+    options.max_bytes = 100;
+    ASSERT_EQ(print(ex, options), "\\x . ((x) x) x");
+}
+
+TEST(PRINTER, max_depth) {
+    auto ex = parse("\\ x . ((x) x) \\ y . y;").execute();
+    PrintOptions options;
+    options.max_depth = 3;
+    ASSERT_EQ(print(ex, options), "\\x . ((...) ...) \\y . ...");
+}
+
+TEST(PRINTER, sharing) {
+    auto arg = church_encode(3);
+    auto ex = make_node<Application>(make_node<Application>(arg, arg),
+                                       make_node<Variable>("y", false));
+    PrintOptions options;
+    options.share = true;
+    auto out = print(ex, options);
+    ASSERT_EQ(out, "'FA' = \\f . \\x . (f) (f) (f) x;\n((FA) FA) y");
+
+    // the output is a script that evaluates to the same term
+    Program program;
+    load_script(program, out + ";", 1);
+    stringstream expected;
+    expected << *ex;
+    stringstream result;
+    result << *program.last_command().execute();
+    ASSERT_EQ(result.str(), expected.str());
+}
+
+TEST(PRINTER, sharing_open_subterms) {
+    // shared subterms with variables bound outside of them are not named
+    auto ex = parse("\\ x . ((x) x) x;").execute();
+    auto lbd = static_pointer_cast<const Lambda>(ex);
+    auto body = lbd->get_body();
+    auto shared = make_node<Lambda>(lbd->get_head(),
+            make_node<Application>(body, body));
+    PrintOptions options;
+    options.share = true;
+    options.min_fragment_size = 1;
+    ASSERT_EQ(print(shared, options),
+              "\\x . (((x) x) x) ((x) x) x");
+}
+
+TEST(PRINTER, deep) {
+    // the printer keeps its own stack, so depth is only bounded by memory
+    auto ex = church_encode(5000);
+    stringstream ss;
+    ss << *ex;
+    ASSERT_EQ(ss.str().size(), string("\\f . \\x . x").size() +
+              5000 * string("(f) ").size());
+}
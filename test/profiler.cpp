@@ -0,0 +1,125 @@
+#include <sstream>
+#include "gtest/gtest.h"
+#include "../src/lib/profiler.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/script-loader.hpp"
+
+using namespace std;
+
+const string library = "'ID' = \\ x . x;\n"
+                       "'SELF' = \\ x . (x) x;\n"
+                       "(SELF) ID >;";
+
+Command load(Program& program) {
+    load_script(program, library, 1, 0, "library.lambda", true);
+    return program.last_command();
+}
+
+TEST(ORIGIN, parsed_nodes) {
+    BufferParser p("\n  'ID' = \\ x . x;");
+    p.track_origins(true);
+    p.set_source("input", 0, 1, 1);
+    auto ex = p.statement()["ID"].ex;
+    auto origin = ex->get_origin();
+    ASSERT_NE(origin, nullptr);
+    ASSERT_EQ(origin->definition->get_name(), "ID");
+    ASSERT_EQ(origin->definition->get_source(), "input");
+    ASSERT_EQ(origin->definition->get_span().line, 2u);
+    ASSERT_EQ(origin->definition->get_span().column, 3u);
+    // the lambda starts at the backslash
+    ASSERT_EQ(origin->span.begin, 10u);
+    ASSERT_EQ(origin->span.line, 2u);
+    ASSERT_EQ(origin->span.column, 10u);
+}
+
+TEST(ORIGIN, script_positions) {
+    Program program;
+    load(program);
+    auto origin = program["SELF"].ex->get_origin();
+    ASSERT_NE(origin, nullptr);
+    ASSERT_EQ(origin->definition->get_source(), "library.lambda");
+    ASSERT_EQ(origin->definition->get_span().line, 2u);
+    ASSERT_EQ(origin->span.begin, 25u);
+}
+
+TEST(ORIGIN, untracked_by_default) {
+    BufferParser p("\\ x . x;");
+    ASSERT_EQ(p.statement().last_command().ex->get_origin(), nullptr);
+}
+
+TEST(ORIGIN, reduction_keeps_origins) {
+    Program program;
+    auto result = load(program).execute();
+    // the result is the body of ID's lambda, instantiated with ID itself
+    auto origin = result->get_origin();
+    ASSERT_NE(origin, nullptr);
+    ASSERT_EQ(origin->definition->get_name(), "ID");
+}
+
+TEST(PROFILER, attribution) {
+    Program program;
+    auto com = load(program);
+    Profile profile;
+    ReductionStats stats;
+    stringstream a, b;
+    a << *com.execute(profile);
+    b << *com.execute(stats);
+    ASSERT_EQ(a.str(), b.str());
+    ASSERT_EQ(profile.stats.beta_steps, stats.beta_steps);
+    ASSERT_EQ(profile.get_samples().size(), 2u);
+
+    // (SELF) ID -> (ID) ID -> ID
+    auto costs = profile.by_definition();
+    ASSERT_EQ(costs.size(), 2u);
+    for(const auto& cost: costs) {
+        ASSERT_EQ(cost.steps, 1u);
+        ASSERT_EQ(cost.source, "library.lambda");
+        ASSERT_TRUE(cost.name == "SELF" || cost.name == "ID") << cost.name;
+    }
+    // the second redex is the body of SELF
+    const auto& frames = profile.get_frames();
+    const auto& second = profile.get_samples()[1].stack;
+    ASSERT_EQ(second.size(), 2u);
+    ASSERT_EQ(frames[second[0]].name, "SELF");
+    ASSERT_EQ(frames[second[1]].name, "ID");
+}
+
+TEST(PROFILER, unknown_origin) {
+    BufferParser p("(\\ x . x) y >;");
+    auto com = p.statement().last_command();
+    Profile profile;
+    com.execute(profile);
+    auto costs = profile.by_definition();
+    ASSERT_EQ(costs.size(), 1u);
+    ASSERT_EQ(costs[0].name, "<unknown>");
+}
+
+TEST(PROFILER, exports) {
+    Program program;
+    auto com = load(program);
+    Profile profile;
+    com.execute(profile);
+
+    stringstream folded;
+    profile.write_folded(folded);
+    ASSERT_EQ(folded.str(), "<expression>;SELF 1\nSELF;ID 1\n");
+
+    stringstream chrome;
+    profile.write_chrome_trace(chrome);
+    ASSERT_NE(chrome.str().find("\"traceEvents\""), string::npos);
+    ASSERT_NE(chrome.str().find("\"name\":\"SELF\""), string::npos);
+    ASSERT_NE(chrome.str().find("\"name\":\"ID\""), string::npos);
+    ASSERT_NE(chrome.str().find("\"source\":\"library.lambda\""),
+              string::npos);
+
+    stringstream speedscope;
+    profile.write_speedscope(speedscope);
+    ASSERT_NE(speedscope.str().find("\"$schema\""), string::npos);
+    ASSERT_NE(speedscope.str().find("\"name\":\"SELF\""), string::npos);
+    ASSERT_NE(speedscope.str().find("\"type\":\"O\""), string::npos);
+    ASSERT_NE(speedscope.str().find("\"type\":\"C\""), string::npos);
+
+    stringstream table;
+    table << profile;
+    ASSERT_NE(table.str().find("library.lambda:2"), string::npos);
+}
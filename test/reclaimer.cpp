@@ -0,0 +1,71 @@
+#include "gtest/gtest.h"
+#include "../src/lib/reclaimer.hpp"
+#include "../src/lib/church-encoding.hpp"
+
+Expression_ptr spine(unsigned int depth) {
+    // (((x) x) x) ... left-nested, like the normal forms of big terms
+    auto x = make_node<Variable>("x", false);
+    Expression_ptr ex = x;
+    for(unsigned int i = 0; i < depth; ++i)
+        ex = make_node<Application>(ex, x);
+    return ex;
+}
+
+TEST(RECLAIMER, deep_terms) {
+    // deep enough to overflow the stack if destroyed recursively
+    MemoryStats before = node_memory();
+    {
+        auto n = church_encode(1000000);
+        auto s = spine(1000000);
+    }
+    ASSERT_EQ(node_memory().live_bytes, before.live_bytes);
+    ASSERT_EQ(Reclaimer::pending(), 0u);
+}
+
+TEST(RECLAIMER, shared_children) {
+    auto x = make_node<Variable>("x", true);
+    Expression_ptr body = make_node<Application>(x, x);
+    {
+        auto lbd = make_node<Lambda>(x, body);
+    }
+    ASSERT_EQ(body.use_count(), 1u);
+    ASSERT_EQ(x.use_count(), 3u);
+}
+
+TEST(RECLAIMER, deferred) {
+    Reclaimer::set_mode(Reclamation::deferred);
+    MemoryStats before = node_memory();
+    Expression_ptr ex = spine(100);
+    std::ptrdiff_t size = node_memory().live_bytes - before.live_bytes;
+    ex.reset();
+    // nothing is freed until collect
+    ASSERT_EQ(node_memory().live_bytes - before.live_bytes, size);
+    ASSERT_EQ(Reclaimer::pending(), 1u);
+    ASSERT_EQ(Reclaimer::collect(10), 10u);
+    ASSERT_GT(node_memory().live_bytes, before.live_bytes);
+    // the children of the freed nodes were queued
+    ASSERT_EQ(Reclaimer::pending(), 1u);
+    // 100 applications and the variable
+    ASSERT_EQ(Reclaimer::collect(), 91u);
+    ASSERT_EQ(Reclaimer::pending(), 0u);
+    ASSERT_EQ(node_memory().live_bytes, before.live_bytes);
+    Reclaimer::set_mode(Reclamation::immediate);
+}
+
+TEST(RECLAIMER, background) {
+    if(!atomic_refcount_default) {
+        ASSERT_THROW(Reclaimer::set_mode(Reclamation::background),
+                     ReclamationUnavailable);
+        ASSERT_EQ(Reclaimer::get_mode(), Reclamation::immediate);
+        return;
+    }
+    Reclaimer::set_mode(Reclamation::background);
+    MemoryStats before = node_memory();
+    {
+        auto ex = spine(10000);
+    }
+    Reclaimer::wait();
+    // freed by the reclamation thread
+    ASSERT_EQ(node_memory().deallocations, before.deallocations);
+    Reclaimer::set_mode(Reclamation::immediate);
+}
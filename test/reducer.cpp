@@ -0,0 +1,72 @@
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/lib/reducer.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+const string omega = "(\\ w . (w) w) \\ w . (w) w";
+
+TEST(REDUCER, steps) {
+    string input = "((\\ x . \\ y . x) a) b;";
+    Reducer reducer(parse(input).ex);
+    vector<string> terms;
+    for(const Step& step: reducer) {
+        ASSERT_EQ(step.index, terms.size() + 1);
+        terms.push_back(to_string(step.term));
+    }
+    ASSERT_EQ(terms, vector<string>({"(\\y . a) b", "a"}));
+    ASSERT_TRUE(reducer.done());
+    ASSERT_EQ(reducer.steps(), 2u);
+    // a finished reducer yields nothing
+    ASSERT_TRUE(reducer.begin() == reducer.end());
+}
+
+TEST(REDUCER, same_result_as_beta_reduction) {
+    string input = "(\\ f . \\ x . (f) (f) x) \\ y . (y) y >;";
+    auto com = parse(input);
+    Reducer reducer(com.ex);
+    reducer.advance(1000);
+    ASSERT_TRUE(reducer.done());
+    ASSERT_EQ(to_string(reducer.term()), to_string(com.execute()));
+}
+
+TEST(REDUCER, lazy) {
+    // omega never finishes, steps are pulled as needed
+    Reducer reducer(parse(omega + ";").ex);
+    ASSERT_EQ(reducer.advance(5), 5u);
+    ASSERT_FALSE(reducer.done());
+    unsigned long last = 0;
+    for(const Step& step: reducer) {
+        last = step.index;
+        if(step.index == 10) break;
+    }
+    ASSERT_EQ(last, 10u);
+    ASSERT_EQ(reducer.steps(), 10u);
+    ASSERT_EQ(to_string(reducer.term()), "(\\w . (w) w) \\w . (w) w");
+}
+
+TEST(REDUCER, strategies) {
+    string input = "(\\ x . y) " + omega + ";";
+    Reducer normal(parse(input).ex, Strategy::normal);
+    ASSERT_EQ(normal.advance(100), 1u);
+    ASSERT_EQ(to_string(normal.term()), "y");
+    Reducer applicative(parse(input).ex, Strategy::applicative);
+    ASSERT_EQ(applicative.advance(100), 100u);
+    ASSERT_EQ(applicative.get_strategy(), Strategy::applicative);
+}
+
+TEST(REDUCER, redex_origins) {
+    BufferParser p("'ID' = \\ x . x;\n(ID) y;");
+    p.track_origins(true);
+    p.statement();
+    auto com = p.statement().last_command();
+    Reducer reducer(com.ex);
+    ASSERT_TRUE(reducer.advance());
+    ASSERT_EQ(to_string(reducer.term()), "y");
+    auto redex = reducer.last_step().redex;
+    ASSERT_NE(redex, nullptr);
+    ASSERT_EQ(redex->span.line, 2u);
+    ASSERT_FALSE(reducer.advance());
+}
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+#include "../src/lib/alpha-equivalence.hpp"
+#include "../src/lib/reduction.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+TEST(STATS, no_stats_matches_beta_reduce) {
+    auto ex = parse("((\\ x . \\ y . (y) x) a) \\ z . z;").ex;
+    while(true) {
+        NoStats none;
+        auto next = beta_step(*ex, none);
+        ASSERT_EQ(to_string(next), to_string(ex->beta_reduce()));
+        if(next == ex) break;
+        ex = next;
+    }
+    ASSERT_EQ(to_string(ex), "a");
+}
+
+TEST(STATS, counters) {
+    // (\x . (x) x) \y . y -> (\y . y) \y . y -> \y . y
+    auto com = parse("(\\ x . (x) x) \\ y . y >;");
+    ReductionStats stats;
+    auto res = com.execute(stats);
+    ASSERT_EQ(to_string(res), to_string(com.execute()));
+    ASSERT_EQ(stats.beta_steps, 2u);
+    ASSERT_EQ(stats.substitutions, 3u);
+    // only (x) x is copied, the arguments are shared
+    ASSERT_EQ(stats.nodes_allocated, 1u);
+    ASSERT_EQ(stats.alpha_conversions, 0u);
+    // application, two lambdas, two variables and one inner application
+    ASSERT_EQ(stats.max_size, 6u);
+    ASSERT_EQ(stats.max_depth, 4u);
+}
+
+TEST(STATS, identity_conversion) {
+    auto com = parse("\\ x . x;");
+    ReductionStats stats;
+    com.execute(stats);
+    ASSERT_EQ(stats.beta_steps, 0u);
+    ASSERT_EQ(stats.max_size, 0u);
+}
+
+TEST(STATS, alpha_conversion) {
+    auto com = parse("\\ x . x x > y;");
+    ReductionStats stats;
+    ASSERT_EQ(to_string(com.execute(stats)), "\\y . y");
+    ASSERT_EQ(stats.alpha_conversions, 1u);
+}
+
+TEST(STATS, accumulate) {
+    auto com = parse("(\\ x . x) y >;");
+    ReductionStats stats;
+    com.execute(stats);
+    com.execute(stats);
+    ASSERT_EQ(stats.beta_steps, 2u);
+    ReductionStats sum;
+    sum += stats;
+    sum += stats;
+    ASSERT_EQ(sum.beta_steps, 4u);
+    ASSERT_EQ(sum.max_size, stats.max_size);
+}
+
+// (2 * 3) + 2 with arithmetic on Church numerals, many shared subterms
+const string arithmetic =
+    "((\\ m . \\ n . \\ f . \\ x . ((m) f) ((n) f) x) "
+    "((\\ m . \\ n . \\ f . (m) (n) f) 2) 3) 2;";
+
+TEST(IN_PLACE, same_steps_as_beta_step) {
+    auto shared = parse(arithmetic).ex;
+    Expression_ptr owned = copy_term(*shared);
+    ASSERT_TRUE(alpha_equivalent(*owned, *shared));
+    NoStats none;
+    for(int i = 0; i < 1000; ++i) {
+        auto next = beta_step(*shared, none);
+        bool changed = reduce_in_place(owned, none);
+        ASSERT_EQ(changed, next != shared);
+        if(!changed) break;
+        ASSERT_TRUE(alpha_equivalent(*owned, *next));
+        shared = next;
+    }
+    ASSERT_EQ(to_string(owned), to_string(church_encode(8)));
+}
+
+TEST(IN_PLACE, shared_nodes_are_not_changed) {
+    auto com = parse(arithmetic);
+    string before = to_string(com.ex);
+    // the command keeps the term, a second reference keeps a subterm
+    auto app = node_cast<Application>(com.ex.get());
+    Expression_ptr argument = app->get_argument();
+    Expression_ptr ex = com.ex;
+    NoStats none;
+    while(reduce_in_place(ex, none)) {}
+    ASSERT_EQ(to_string(ex), to_string(church_encode(8)));
+    ASSERT_EQ(to_string(com.ex), before);
+    ASSERT_EQ(to_string(argument), to_string(church_encode(2)));
+}
+
+TEST(IN_PLACE, fewer_allocations) {
+    auto com = parse(arithmetic);
+    ReductionStats copying;
+    {
+        CollectStats collect(copying);
+        Expression_ptr ex = com.ex;
+        for(auto next = beta_step(*ex, collect); next != ex;
+            next = beta_step(*ex, collect))
+            ex = next;
+    }
+    ReductionStats in_place;
+    auto res = BetaReduction(0, 0).execute(com.ex, in_place);
+    ASSERT_EQ(to_string(res), to_string(church_encode(8)));
+    ASSERT_EQ(in_place.beta_steps, copying.beta_steps);
+    ASSERT_LT(in_place.nodes_allocated, copying.nodes_allocated);
+}
+
+TEST(IN_PLACE, copy_shares_no_inner_nodes) {
+    auto ex = parse("\\ x . ((x) x) (x) x;").ex;
+    auto copy = copy_term(*ex);
+    ASSERT_TRUE(alpha_equivalent(*copy, *ex));
+    ASSERT_NE(copy, ex);
+    auto body = node_cast<Application>(
+        node_cast<Lambda>(copy.get())->get_body().get());
+    ASSERT_NE(body, node_cast<Lambda>(ex.get())->get_body().get());
+    ASSERT_EQ(body->get_function().use_count(), 1u);
+}
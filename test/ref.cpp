@@ -0,0 +1,100 @@
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/lib/lambda-struct.hpp"
+
+class Counted : public RefCounted {
+  public:
+    explicit Counted(int& destroyed) : destroyed(destroyed) {}
+    virtual ~Counted() {
+        ++destroyed;
+    }
+  private:
+    int& destroyed;
+};
+
+class Derived final : public Counted {
+  public:
+    using Counted::Counted;
+};
+
+TEST(REF, counting) {
+    int destroyed = 0;
+    {
+        Ref<Counted> a(new Counted(destroyed));
+        ASSERT_EQ(a.use_count(), 1u);
+        {
+            Ref<Counted> b = a;
+            ASSERT_EQ(a.use_count(), 2u);
+            Ref<Counted> c = std::move(b);
+            ASSERT_FALSE(b);
+            ASSERT_EQ(a.use_count(), 2u);
+        }
+        ASSERT_EQ(a.use_count(), 1u);
+        // a new Ref can be made from the raw pointer at any time
+        Ref<Counted> d(a.get());
+        ASSERT_EQ(d, a);
+        ASSERT_EQ(a.use_count(), 2u);
+        ASSERT_EQ(destroyed, 0);
+    }
+    ASSERT_EQ(destroyed, 1);
+}
+
+TEST(REF, assignment) {
+    int destroyed = 0;
+    Ref<Counted> a(new Counted(destroyed));
+    Ref<Counted> b(new Counted(destroyed));
+    a = b;
+    ASSERT_EQ(destroyed, 1);
+    a = a;
+    ASSERT_EQ(a.use_count(), 2u);
+    a.reset();
+    b = nullptr;
+    ASSERT_EQ(a, nullptr);
+    ASSERT_EQ(destroyed, 2);
+}
+
+TEST(REF, casts) {
+    int destroyed = 0;
+    Ref<const Counted> base = Ref<Derived>(new Derived(destroyed));
+    ASSERT_EQ(base.use_count(), 1u);
+    auto derived = dynamic_pointer_cast<const Derived>(base);
+    ASSERT_EQ(derived, base);
+    ASSERT_EQ(base.use_count(), 2u);
+    Ref<const Counted> other(new Counted(destroyed));
+    ASSERT_FALSE(dynamic_pointer_cast<const Derived>(other));
+    ASSERT_EQ(static_pointer_cast<const Derived>(base), derived);
+}
+
+TEST(REF, hash) {
+    auto x = make_node<Variable>("x", false);
+    auto y = make_node<Variable>("y", false);
+    std::unordered_set<Expression_ptr> set{x, y, x};
+    ASSERT_EQ(set.size(), 2u);
+    ASSERT_TRUE(set.count(Expression_ptr(x)));
+}
+
+TEST(REF, atomic) {
+    // atomic handles may be copied and dropped concurrently
+    SharedExpression_ptr shared = make_node<Variable>("x", false);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t)
+        threads.emplace_back([shared]() {
+            for(int i = 0; i < 10000; ++i) {
+                SharedExpression_ptr copy = shared;
+                ASSERT_TRUE(copy);
+            }
+        });
+    for(auto& t: threads) t.join();
+    ASSERT_EQ(shared.use_count(), 1u);
+}
+
+TEST(REF, nodes) {
+    auto x = make_node<Variable>("x", true);
+    auto id = make_node<Lambda>(x, x);
+    ASSERT_EQ(x.use_count(), 3u);
+    Expression_ptr same = id->shared_from_this();
+    ASSERT_EQ(same, id);
+    ASSERT_EQ(id.use_count(), 2u);
+}
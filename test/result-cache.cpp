@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "gtest/gtest.h"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/result-cache.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+class ResultCacheTest : public ::testing::Test {
+  protected:
+    ResultCacheTest()
+        : is(), p(is, 100000), directory("result-cache-test.cache") {
+        filesystem::remove_all(directory);
+    }
+    ~ResultCacheTest() {
+        Command::results = nullptr;
+        filesystem::remove_all(directory);
+    }
+    Command command(const string& statement) {
+        is << statement;
+        return p.statement().last_command();
+    }
+    vector<filesystem::path> entries() {
+        vector<filesystem::path> res;
+        for(auto& entry: filesystem::directory_iterator(directory))
+            res.push_back(entry.path());
+        return res;
+    }
+    stringstream is;
+    Parser p;
+    string directory;
+};
+
+TEST_F(ResultCacheTest, StoredResultIsFound) {
+    auto cache = make_shared<ResultCache>(directory);
+    Command::results = cache;
+    Command com = command("(\\ x . (x) x) \\ y . (y) z >;");
+    ReductionStats first;
+    string expected = to_string(com.execute(first));
+    ASSERT_GT(first.beta_steps, 0u);
+    ASSERT_EQ(cache->get_stats().misses, 1u);
+    ASSERT_EQ(cache->get_stats().stores, 1u);
+    ASSERT_EQ(entries().size(), 1u);
+    Command again = command("(\\ x . (x) x) \\ y . (y) z >;");
+    ReductionStats second;
+    ASSERT_EQ(to_string(again.execute(second)), expected);
+    ASSERT_EQ(second.beta_steps, 0u);
+    ASSERT_EQ(cache->get_stats().hits, 1u);
+}
+
+TEST_F(ResultCacheTest, SameOutputAsUncached) {
+    // alpha equivalent terms must not get each other's bound names
+    Command::results = make_shared<ResultCache>(directory);
+    command("(\\ a . \\ b . (a) b) \\ p . p >;").execute();
+    Command com = command("(\\ x . \\ y . (x) y) \\ q . q >;");
+    string cached = to_string(com.execute());
+    Command::results = nullptr;
+    string uncached = to_string(com.execute());
+    ASSERT_EQ(uncached, "\\y . y");
+    ASSERT_EQ(cached, uncached);
+}
+
+TEST_F(ResultCacheTest, KeyDependsOnTermAndConversion) {
+    ResultCache cache(directory);
+    string key = cache.key(command("(\\ x . x) w >;"));
+    ASSERT_FALSE(key.empty());
+    ASSERT_EQ(cache.key(command("(\\ x . x) w >;")), key);
+    ASSERT_NE(cache.key(command("(\\ y . y) w >;")), key);
+    ASSERT_NE(cache.key(command("(\\ x . x) v >;")), key);
+    ASSERT_NE(cache.key(command("(\\ x . w) w >;")), key);
+    ASSERT_NE(cache.key(command("(\\ x . x) w 1 >;")), key);
+    ASSERT_NE(cache.key(command("(\\ x . x) w > cbv;")), key);
+}
+
+TEST_F(ResultCacheTest, ReferencesAreKeyedByDefinition) {
+    ResultCache cache(directory);
+    command("'ID' = \\ x . x;");
+    command("'I' = \\ x . x;");
+    command("'K' = \\ x . \\ y . x;");
+    string key = cache.key(command("(ID) w >;"));
+    ASSERT_FALSE(key.empty());
+    ASSERT_EQ(cache.key(command("(I) w >;")), key);
+    ASSERT_NE(cache.key(command("(K) w >;")), key);
+    // without a definition, the name would be all there is
+    Command unknown(make_node<Reference>("ID", []() {
+                        return make_node<Variable>("x", false);
+                    }),
+                    make_shared<BetaReduction>(0, 1000));
+    ASSERT_TRUE(cache.key(unknown).empty());
+    ASSERT_EQ(cache.find(unknown), nullptr);
+}
+
+TEST_F(ResultCacheTest, DigestsOfRedefinedNamesAreDropped) {
+    ResultCache cache(directory);
+    for(int i = 0; i < 1000; ++i) {
+        command("'F' = \\ x . x;");
+        ASSERT_FALSE(cache.key(command("(F) w >;")).empty());
+    }
+    ASSERT_LT(cache.digest_count(), 200u);
+}
+
+TEST_F(ResultCacheTest, SharedBetweenCaches) {
+    Command com = command("(\\ x . (x) x) \\ y . y >;");
+    string expected;
+    {
+        Command::results = make_shared<ResultCache>(directory);
+        expected = to_string(com.execute());
+    }
+    // e.g. another process
+    auto cache = make_shared<ResultCache>(directory);
+    Command::results = cache;
+    ReductionStats stats;
+    ASSERT_EQ(to_string(com.execute(stats)), expected);
+    ASSERT_EQ(stats.beta_steps, 0u);
+    ASSERT_EQ(cache->get_stats().hits, 1u);
+}
+
+TEST_F(ResultCacheTest, DamagedEntryIsMiss) {
+    auto cache = make_shared<ResultCache>(directory);
+    Command::results = cache;
+    Command com = command("(\\ x . x) w >;");
+    string expected = to_string(com.execute());
+    ASSERT_EQ(entries().size(), 1u);
+    {
+        ofstream out(entries().front(), ios::binary | ios::trunc);
+        out << "LCRC garbage";
+    }
+    ASSERT_EQ(to_string(com.execute()), expected);
+    ASSERT_EQ(cache->get_stats().hits, 0u);
+    ASSERT_EQ(cache->get_stats().misses, 2u);
+    // the damaged entry has been replaced
+    ASSERT_EQ(to_string(com.execute()), expected);
+    ASSERT_EQ(cache->get_stats().hits, 1u);
+}
+
+TEST_F(ResultCacheTest, LeastRecentlyUsedAreEvicted) {
+    uintmax_t size;
+    {
+        ResultCache probe(directory);
+        Command com = command("(\\ x . x) a >;");
+        probe.insert(com, com.execute());
+        size = filesystem::file_size(entries().front());
+        filesystem::remove(entries().front());
+    }
+    auto cache = make_shared<ResultCache>(directory, 4 * size);
+    Command::results = cache;
+    vector<Command> commands;
+    auto old = filesystem::file_time_type::clock::now() - 1h;
+    for(int i = 0; i < 4; ++i) {
+        commands.push_back(command("(\\ x . x) " + string(1, 'a' + i)
+                                   + " >;"));
+        auto before = entries();
+        commands.back().execute();
+        // stored a minute after the one before
+        for(auto& entry: entries())
+            if(find(before.begin(), before.end(), entry) == before.end())
+                filesystem::last_write_time(entry, old + i * 1min);
+    }
+    ASSERT_EQ(entries().size(), 4u);
+    ASSERT_EQ(cache->get_stats().evictions, 0u);
+    // a is used again, so b and c are the least recently used
+    commands[0].execute();
+    ASSERT_EQ(cache->get_stats().hits, 1u);
+    command("(\\ x . x) e >;").execute();
+    ASSERT_GT(cache->get_stats().evictions, 0u);
+    ASSERT_LE(entries().size(), 3u);
+    commands[0].execute();
+    ASSERT_EQ(cache->get_stats().hits, 2u);
+    commands[1].execute();
+    ASSERT_EQ(cache->get_stats().hits, 2u);
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <fstream>
+#include "gtest/gtest.h"
+#include "../src/lib/script-loader.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+static const std::string LIBRARY =
+    "# a small library; separators in comments are ignored\n"
+    "'ID' = \\ x . x;\n"
+    "'TRUE' = \\ a . \\ b . a;\n"
+    "'FALSE' = \\ a . \\ b . b;\n"
+    "'NOT' = \\ p . ((p) FALSE) TRUE;\n"
+    "'T' = (NOT) FALSE >;\n"
+    "'I' = (ID) (ID) ID >;\n"
+    "(ID) y >;  # trailing comment; with separator\n";
+
+TEST(SPLIT, statements) {
+    auto st = split_statements("a; # b; c\n d;  ");
+    ASSERT_EQ(st.size(), 3u);
+    ASSERT_EQ(st[0], "a;");
+    ASSERT_EQ(st[1], " # b; c\n d;");
+    ASSERT_EQ(st[2], "  ");
+}
+
+TEST(LOADER, same_as_serial) {
+    Program program;
+    load_script(program, LIBRARY, 4);
+    ASSERT_TRUE(program.contains("NOT"));
+    ASSERT_EQ(to_string(program["T"].execute()), "\\a . \\b . a");
+    ASSERT_EQ(to_string(program["I"].execute()), "\\x . x");
+    ASSERT_EQ(to_string(program.last_command().execute()), "y");
+
+    // compare against parsing the library with a single Parser
+    std::stringstream is(LIBRARY);
+    Parser parser(is);
+    for(int i = 0; i < 7; ++i) parser.statement();
+    for(const auto& name: {"ID", "TRUE", "FALSE", "NOT", "T", "I"})
+        ASSERT_EQ(to_string(program[name].execute()),
+                  to_string(parser.program[name].execute()));
+}
+
+TEST(LOADER, source_order) {
+    // B must see the first definition of A, C the second one
+    Program program;
+    load_script(program, "'A' = a; 'B' = A; 'A' = b; 'C' = A;");
+    ASSERT_EQ(to_string(program["B"].execute()), "a");
+    ASSERT_EQ(to_string(program["C"].execute()), "b");
+}
+
+TEST(LOADER, errors) {
+    Program program;
+    ASSERT_THROW(load_script(program, "'A' = a; 'B' = (C) A;"),
+                 SyntaxException);
+    // statements before the faulty one are kept
+    ASSERT_TRUE(program.contains("A"));
+    ASSERT_THROW(load_script(program, "'A' = b"), SyntaxException);
+    ASSERT_THROW(load_script_file(program, "does/not/exist.lambda"),
+                 FileError);
+}
+
+TEST(LOADER, file) {
+    std::string path = "script-loader-test.lambda";
+    {
+        std::ofstream out(path);
+        out << LIBRARY;
+    }
+    Program program;
+    load_script_file(program, path);
+    std::remove(path.c_str());
+    ASSERT_EQ(to_string(program["T"].execute()), "\\a . \\b . a");
+}
@@ -0,0 +1,184 @@
+#include <cstdio>
+#include "gtest/gtest.h"
+#include "../src/lib/serialization.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+TEST(SERIALIZATION, roundtrip) {
+    auto ex = parse("\\ x . ((\\ y . (y) x) z) \\ x . x;").execute();
+    stringstream ss;
+    write_expression(ss, ex);
+    auto res = read_expression(ss.str());
+    ASSERT_EQ(to_string(*res), to_string(*ex));
+}
+
+TEST(SERIALIZATION, sharing) {
+    // the argument is written once and stays shared after reading
+    auto arg = church_encode(50);
+    auto ex = make_node<Application>(make_node<Application>(arg, arg),
+                                       arg);
+    stringstream ss;
+    write_expression(ss, ex);
+    stringstream single;
+    write_expression(single, arg);
+    ASSERT_LT(ss.str().size(), single.str().size() + 16);
+
+    auto res = static_pointer_cast<const Application>(
+            read_expression(ss.str()));
+    auto fst = static_pointer_cast<const Application>(res->get_function());
+    ASSERT_EQ(fst->get_function(), fst->get_argument());
+    ASSERT_EQ(fst->get_function(), res->get_argument());
+    ASSERT_EQ(to_string(*res), to_string(*ex));
+}
+
+TEST(SERIALIZATION, binders) {
+    // both variables are named x, but bound by different lambdas
+    auto x1 = make_node<Variable>("x", true);
+    auto x2 = make_node<Variable>("x", true);
+    auto ex = make_node<Lambda>(x1, make_node<Lambda>(x2,
+                make_node<Application>(x1, x2)));
+    stringstream ss;
+    write_expression(ss, ex);
+    auto res = static_pointer_cast<const Lambda>(read_expression(ss.str()));
+    auto inner = static_pointer_cast<const Lambda>(res->get_body());
+    auto app = static_pointer_cast<const Application>(inner->get_body());
+    ASSERT_EQ(app->get_function(), res->get_head());
+    ASSERT_EQ(app->get_argument(), inner->get_head());
+    // the result still reduces like the original
+    auto arg = make_node<Variable>("a", false);
+    auto reduced = make_node<Application>(res, arg)->beta_reduce();
+    ASSERT_EQ(to_string(*reduced), "\\x . (a) x");
+}
+
+TEST(SERIALIZATION, stream) {
+    stringstream ss;
+    BinaryWriter writer(ss);
+    auto id = parse("\\ x . x;").execute();
+    writer.write(id);
+    writer.write(make_node<Application>(id, id));
+    writer.finish();
+    // the reader does not copy its input
+    string data = ss.str();
+    BinaryReader reader(data);
+    ASSERT_TRUE(reader.next());
+    auto first = reader.expression();
+    ASSERT_TRUE(reader.next());
+    auto second = static_pointer_cast<const Application>(reader.expression());
+    ASSERT_EQ(second->get_function(), first);
+    ASSERT_FALSE(reader.next());
+    ASSERT_FALSE(reader.next());
+}
+
+TEST(SERIALIZATION, temporary_references) {
+    // references written as their value are kept alive by the writer, so a
+    // later node at the same address is not mistaken for them
+    stringstream ss;
+    BinaryWriter writer(ss);
+    for(string name: {"a", "b"}) {
+        writer.write(make_node<Reference>(name, [name]() {
+            return make_node<Variable>(name, false);
+        }));
+    }
+    writer.finish();
+    string data = ss.str();
+    BinaryReader reader(data);
+    ASSERT_TRUE(reader.next());
+    ASSERT_EQ(to_string(reader.expression()), "a");
+    ASSERT_TRUE(reader.next());
+    ASSERT_EQ(to_string(reader.expression()), "b");
+}
+
+TEST(SERIALIZATION, program) {
+    stringstream is;
+    Parser p(is);
+    is << "'ID' = \\ x . x; 'A' = (ID) a >; 'B' = \\ x . x x>y; (ID) b;";
+    for(int i = 0; i < 4; ++i) p.statement();
+    string path = "serialization-test.lcbf";
+    save_program(p.program, path);
+    Program loaded;
+    load_program(loaded, path);
+    remove(path.c_str());
+    for(const auto& name: {"ID", "A", "B", "last"}) {
+        ASSERT_TRUE(loaded.contains(name));
+        ASSERT_EQ(to_string(*loaded[name].execute()),
+                  to_string(*p.program[name].execute()));
+    }
+    ASSERT_TRUE(dynamic_pointer_cast<BetaReduction>(loaded["A"].c));
+    ASSERT_TRUE(dynamic_pointer_cast<AlphaConversion>(loaded["B"].c));
+}
+
+TEST(SERIALIZATION, errors) {
+    ASSERT_THROW(read_expression("LCBX"), SerializationError);
+    ASSERT_THROW(read_expression(string("LCBF\x02", 5)), SerializationError);
+    // truncated stream
+    stringstream ss;
+    write_expression(ss, parse("\\ x . x;").execute());
+    string data = ss.str();
+    ASSERT_THROW(read_expression(data.substr(0, data.size() - 3)),
+                 SerializationError);
+    // reference to a node that does not exist
+    ASSERT_THROW(read_expression(string("LCBF\x01" "E\x01", 7)),
+                 SerializationError);
+}
+
+TEST(SERIALIZATION, snapshot) {
+    stringstream is;
+    Parser p(is);
+    is << "'ID' = \\ x . x; 'A' = (ID) a >; (ID) b;";
+    for(int i = 0; i < 3; ++i) p.statement();
+    string path = "serialization-test.snapshot";
+    save_snapshot(p.program, path);
+    Program loaded;
+    load_snapshot(loaded, path);
+    remove(path.c_str());
+    ASSERT_FALSE(loaded.contains(Program::last_key));
+    // symbols are stored evaluated, without conversion
+    ASSERT_EQ(to_string(*loaded["A"].ex), "a");
+    ASSERT_FALSE(dynamic_pointer_cast<BetaReduction>(loaded["A"].c));
+    ASSERT_EQ(to_string(*loaded["ID"].execute()), "\\x . x");
+}
+
+TEST(SERIALIZATION, strategy) {
+    stringstream is;
+    Parser p(is);
+    is << "'A' = (\\ x . x) a > cbv; 'B' = (\\ x . x) b 3 > whnf;";
+    for(int i = 0; i < 2; ++i) p.statement();
+    stringstream os;
+    write_program(os, p.program);
+    Program loaded;
+    read_program(loaded, os.str());
+    auto a = dynamic_pointer_cast<BetaReduction>(loaded["A"].c);
+    auto b = dynamic_pointer_cast<BetaReduction>(loaded["B"].c);
+    ASSERT_TRUE(a && b);
+    ASSERT_EQ(a->strategy, Strategy::call_by_value);
+    ASSERT_EQ(b->strategy, Strategy::weak_head);
+    ASSERT_EQ(b->num_steps, 3u);
+}
+
+TEST(SERIALIZATION, references) {
+    stringstream is;
+    Parser p(is);
+    is << "'LOOP' = (\\ x . (x) x) \\ x . (x) x >; (\\ y . z) LOOP;";
+    p.statement();
+    Program program = p.statement();
+    auto ex = program.last_command().ex;
+    // kept as names, so LOOP is not evaluated
+    stringstream os;
+    BinaryWriter writer(os, true);
+    writer.write(ex);
+    writer.finish();
+    string data = os.str();
+    ASSERT_THROW(read_expression(data), SerializationError);
+    BinaryReader reader(data, &program);
+    ASSERT_TRUE(reader.next());
+    auto app = node_cast<Application>(reader.expression().get());
+    ASSERT_TRUE(app);
+    ASSERT_EQ(app->get_argument(), program.reference("LOOP"));
+    ASSERT_FALSE(node_cast<Reference>(app->get_argument().get())
+                 ->is_resolved());
+    Program other;
+    BinaryReader undefined(data, &other);
+    ASSERT_THROW(undefined.next(), SerializationError);
+}
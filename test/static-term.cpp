@@ -0,0 +1,90 @@
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "../src/lib/alpha-equivalence.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "../src/lib/static-term.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+// parsed by the compiler, a typo here does not compile
+constexpr auto K = R"(\ a . \ b . a)"_lambda;
+constexpr auto S = R"(\ x . \ y . \ z . ((x) z) (y) z)"_lambda;
+constexpr StaticTerm OMEGA("(\\ w . (w) w) \\ w . (w) w");
+
+// malformed terms are rejected at compile time
+static_assert(StaticTerm<sizeof("\\ x . x")>::check("\\ x . x") == nullptr);
+static_assert(StaticTerm<sizeof("(f x")>::check("(f x") != nullptr);
+static_assert(StaticTerm<sizeof("\\ x x")>::check("\\ x x") != nullptr);
+static_assert(StaticTerm<sizeof("ID")>::check("ID") != nullptr);
+static_assert(StaticTerm<sizeof("x )")>::check("x )") != nullptr);
+static_assert(StaticTerm<sizeof("")>::check("") != nullptr);
+
+// the table itself is a constant
+static_assert(K.node_count() == 4);
+static_assert(K.node(K.get_root()).kind == StaticKind::lambda);
+static_assert(K.name(K.node(0)) == "a");
+
+TEST(STATIC_TERM, same_as_parser) {
+    ASSERT_EQ(to_string(*K.build()), "\\a . \\b . a");
+    ASSERT_TRUE(alpha_equivalent(*S.build(),
+        *parse_term("\\ x . \\ y . \\ z . ((x) z) (y) z")));
+    ASSERT_TRUE(alpha_equivalent(*OMEGA.build(),
+        *parse_term("(\\ w . (w) w) \\ w . (w) w")));
+}
+
+TEST(STATIC_TERM, binders) {
+    auto omega = node_cast<Application>(OMEGA.build().get());
+    // both halves bind their own w
+    auto f = node_cast<Lambda>(omega->get_function().get());
+    auto g = node_cast<Lambda>(omega->get_argument().get());
+    ASSERT_NE(f->get_head(), g->get_head());
+    auto body = node_cast<Application>(f->get_body().get());
+    ASSERT_EQ(body->get_function(), f->get_head());
+    ASSERT_EQ(body->get_argument(), f->get_head());
+    // shadowing and free variables
+    constexpr auto T = R"(\ x . (\ x . (x) y) x # comment
+                        )"_lambda;
+    ASSERT_TRUE(alpha_equivalent(*T.build(),
+                                 *parse_term("\\ x . (\\ x . (x) y) x")));
+}
+
+TEST(STATIC_TERM, literals) {
+    constexpr auto T = "((\\ p . p) true) 3"_lambda;
+    ASSERT_EQ(to_string(*T.build()),
+              "((\\p . p) \\a . \\b . a) \\f . \\x . (f) (f) (f) x");
+}
+
+TEST(STATIC_TERM, shared) {
+    // built once, no parsing and no allocation afterwards
+    const Expression_ptr& k = static_term<K>();
+    ASSERT_EQ(k.get(), static_term<K>().get());
+    BetaReduction beta(0, 0);
+    auto res = beta.execute(make_node<Application>(
+        make_node<Application>(k, make_node<Variable>("u", false)),
+        make_node<Variable>("v", false)));
+    ASSERT_EQ(to_string(*res), "u");
+}
+
+TEST(STATIC_TERM, threads) {
+    // every thread may copy the term, see static_term
+    vector<thread> threads;
+    vector<string> results(4);
+    for(auto& res: results)
+        threads.emplace_back([&res]() {
+            Expression_ptr k = static_term<K>();
+            BetaReduction beta(0, 0);
+            res = to_string(*beta.execute(make_node<Application>(
+                make_node<Application>(k, make_node<Variable>("u", false)),
+                make_node<Variable>("v", false))));
+        });
+    for(auto& t: threads) t.join();
+    for(const auto& res: results) ASSERT_EQ(res, "u");
+}
+
+TEST(STATIC_TERM, runtime_errors) {
+    // outside of constant expressions, errors are exceptions
+    ASSERT_THROW(StaticTerm("(\\ x . x"), SyntaxException);
+    ASSERT_THROW(StaticTerm("A"), SyntaxException);
+}
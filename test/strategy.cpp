@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include "../src/lib/strategy.hpp"
+#include "../src/lib/reducer.hpp"
+#include "../src/lib/lambda-syntax.hpp"
+#include "test-helpers.hpp"
+
+using namespace std;
+
+struct Result {
+    string term;
+    unsigned long steps;
+};
+
+Result reduce(const string& input, Strategy strategy,
+              unsigned long max_iter = 100) {
+    BetaReduction beta(max_iter, max_iter, strategy);
+    ReductionStats stats;
+    auto res = beta.execute(parse(input).ex, stats);
+    return {to_string(res), stats.beta_steps};
+}
+
+const string omega = "(\\ w . (w) w) \\ w . (w) w";
+
+TEST(STRATEGY, names) {
+    for(auto s: {Strategy::normal, Strategy::applicative,
+                 Strategy::call_by_value, Strategy::head,
+                 Strategy::weak_head, Strategy::development})
+        ASSERT_EQ(parse_strategy(strategy_name(s)), s);
+    ASSERT_THROW(parse_strategy("lazy"), SyntaxException);
+}
+
+TEST(STRATEGY, normal_order_is_default) {
+    BufferParser p("(\\ x . x) y >;");
+    auto c = dynamic_pointer_cast<BetaReduction>(p.statement()
+                                                 .last_command().c);
+    ASSERT_EQ(c->strategy, Strategy::normal);
+    // same steps as beta_step
+    auto ex = parse("(\\ x . (x) x) (\\ y . y) z;").ex;
+    NoStats none;
+    for(auto next = beta_step(*ex, none); next != ex;
+        next = beta_step(*ex, none)) {
+        ASSERT_EQ(to_string(next), to_string(NormalOrder::step(*ex, none)));
+        ex = next;
+    }
+}
+
+TEST(STRATEGY, discarded_divergent_argument) {
+    string input = "(\\ x . y) " + omega + ";";
+    for(auto s: {Strategy::normal, Strategy::head, Strategy::weak_head}) {
+        auto r = reduce(input, s);
+        ASSERT_EQ(r.term, "y");
+        ASSERT_EQ(r.steps, 1u);
+    }
+    // the development contracts the redex of omega as well, then drops it
+    auto r = reduce(input, Strategy::development);
+    ASSERT_EQ(r.term, "y");
+    ASSERT_EQ(r.steps, 2u);
+    ASSERT_THROW(reduce(input, Strategy::call_by_value),
+                 MaxIterationsExceeded);
+    ASSERT_THROW(reduce(input, Strategy::applicative), MaxIterationsExceeded);
+}
+
+TEST(STRATEGY, shared_argument) {
+    // call-by-value reduces the argument once instead of twice
+    string input = "(\\ x . (x) x) (\\ y . y) z;";
+    auto normal = reduce(input, Strategy::normal);
+    auto cbv = reduce(input, Strategy::call_by_value);
+    ASSERT_EQ(normal.term, "(z) z");
+    ASSERT_EQ(cbv.term, "(z) z");
+    ASSERT_EQ(normal.steps, 3u);
+    ASSERT_EQ(cbv.steps, 2u);
+}
+
+TEST(STRATEGY, under_lambda) {
+    // only normal, applicative and head order reduce inside lambdas
+    string input = "\\ x . (\\ y . y) x;";
+    ASSERT_EQ(reduce(input, Strategy::normal).term, "\\x . x");
+    ASSERT_EQ(reduce(input, Strategy::applicative).term, "\\x . x");
+    ASSERT_EQ(reduce(input, Strategy::head).term, "\\x . x");
+    ASSERT_EQ(reduce(input, Strategy::call_by_value).steps, 0u);
+    ASSERT_EQ(reduce(input, Strategy::weak_head).steps, 0u);
+}
+
+TEST(STRATEGY, values) {
+    // call-by-value does not reduce lambdas that are arguments,
+    // applicative order normalizes them first
+    string input = "(\\ f . f) \\ x . (\\ y . y) x;";
+    auto cbv = reduce(input, Strategy::call_by_value);
+    ASSERT_EQ(cbv.term, "\\x . (\\y . y) x");
+    ASSERT_EQ(cbv.steps, 1u);
+    auto app = reduce(input, Strategy::applicative);
+    ASSERT_EQ(app.term, "\\x . x");
+    ASSERT_EQ(app.steps, 2u);
+}
+
+TEST(STRATEGY, head_only) {
+    // arguments of a variable in head position are never reduced
+    string input = "(z) (\\ y . y) a;";
+    ASSERT_EQ(reduce(input, Strategy::head).steps, 0u);
+    ASSERT_EQ(reduce(input, Strategy::weak_head).steps, 0u);
+    ASSERT_EQ(reduce(input, Strategy::normal).term, "(z) a");
+}
+
+TEST(STRATEGY, syntax) {
+    BufferParser p("(\\ x . x) y > cbv; (\\ x . x) y 3 > whnf; "
+                   "(\\ x . x) y > lazy;");
+    auto c = dynamic_pointer_cast<BetaReduction>(
+        p.statement().last_command().c);
+    ASSERT_EQ(c->strategy, Strategy::call_by_value);
+    c = dynamic_pointer_cast<BetaReduction>(p.statement().last_command().c);
+    ASSERT_EQ(c->strategy, Strategy::weak_head);
+    ASSERT_EQ(c->num_steps, 3u);
+    ASSERT_THROW(p.statement(), SyntaxException);
+}
+
+TEST(STRATEGY, church_arithmetic) {
+    // all strategies that reduce under lambdas agree on normal forms
+    string input = "(\\ m . \\ n . \\ f . \\ x . ((m) f) ((n) f) x) "
+                   "(\\ f . \\ x . (f) x) \\ f . \\ x . (f) (f) x;";
+    auto normal = reduce(input, Strategy::normal);
+    ASSERT_EQ(reduce(input, Strategy::applicative).term, normal.term);
+    ASSERT_EQ(reduce(input, Strategy::head).term, normal.term);
+    ASSERT_EQ(reduce(input, Strategy::development).term, normal.term);
+}
+
+TEST(STRATEGY, complete_development) {
+    // one step contracts both independent redexes, but not the one it
+    // creates: (\ x . x) a and (\ y . y) b, then (a) b is normal
+    auto ex = parse("((\\ x . x) a) (\\ y . y) b;").ex;
+    NoStats none;
+    ASSERT_EQ(to_string(CompleteDevelopment::step(*ex, none)), "(a) b");
+    // the redex created by contracting the outer one is left for later
+    ex = parse("((\\ f . f) \\ x . x) y;").ex;
+    ASSERT_EQ(to_string(CompleteDevelopment::step(*ex, none)),
+              "(\\x . x) y");
+    // normal forms are returned as they are
+    ex = parse("\\ x . (x) y;").ex;
+    ASSERT_EQ(CompleteDevelopment::step(*ex, none), ex);
+}
+
+TEST(STRATEGY, development_passes) {
+    // n independent redexes: n normal order steps, but one development
+    string input = "z";
+    for(int i = 0; i < 5; ++i) input = "(" + input + ") (\\ x . x) a";
+    input += ";";
+    BetaReduction normal(0, 100);
+    BetaReduction development(0, 100, Strategy::development);
+    ReductionStats a, b;
+    auto expected = normal.execute(parse(input).ex, a);
+    auto result = development.execute(parse(input).ex, b);
+    ASSERT_TRUE(alpha_equivalent(*expected, *result));
+    ASSERT_EQ(a.beta_steps, 5u);
+    ASSERT_EQ(b.beta_steps, 5u);
+    Reducer reducer(parse(input).ex, Strategy::development);
+    ASSERT_EQ(reducer.advance(100), 1u);
+}
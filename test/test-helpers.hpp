@@ -0,0 +1,35 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include "../src/lib/lambda-syntax.hpp"
+
+/**
+ * ABSTRACT:
+ * This header contains helpers that the unit tests share: printing a term
+ * to a string and parsing a single statement.
+ */
+
+inline std::string to_string(const Expression& ex) {
+    std::stringstream ss;
+    ss << ex;
+    return ss.str();
+}
+
+inline std::string to_string(const Expression_ptr& ex) {
+    return to_string(*ex);
+}
+
+inline Command parse(const std::string& statement) {
+    /**
+     * @return the command of statement, which includes its semicolon
+     */
+    BufferParser p(statement);
+    return p.statement().last_command();
+}
+
+inline Expression_ptr parse_term(const std::string& term) {
+    /**
+     * @return the expression term, which has no semicolon
+     */
+    return parse(term + ";").ex;
+}
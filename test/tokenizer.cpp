@@ -208,4 +208,127 @@ TEST(TOKENIZER, overwriteSymbolError) {
     stringstream ss;
     Tokenizer<MySymbol> tz(ss);
     tz.get();
-}*/
\ No newline at end of file
+}*/
+void buffer_test(std::string input) {
+    // the buffer tokenizer has to produce the same tokens as the stream one
+    stringstream ss;
+    ss << input;
+    Tokenizer<> tz{ss};
+    BufferTokenizer<> btz{input};
+    unsigned short i = 0;
+    for(Token t = tz.get(); t; t = tz.get(), ++i) {
+        TokenView v = btz.get();
+        ASSERT_EQ(v.tok, t.tok);
+        ASSERT_EQ(std::string(v.str), t.str);
+        ASSERT_EQ(input.substr(v.offset, v.str.size()), t.str);
+    }
+    ASSERT_FALSE(btz.get());
+    ASSERT_GE(i, 1);
+}
+
+TEST(BUFFER_TOKENIZER, same_as_stream) {
+    buffer_test("\\ x. x");
+    buffer_test("(\\x.x)bt bt>z");
+    buffer_test("(\\x.x)bt 77>");
+    buffer_test("# this is a comment\n 'A' = \\ x . x; (A) y;");
+    buffer_test("'ID' = \\ x. x;# trailing comment");
+    buffer_test("true false");
+}
+TEST(BUFFER_TOKENIZER, offsets) {
+    std::string input = "'ID' = \\ xy. xy;";
+    BufferTokenizer<> tz{input};
+    std::size_t expected[] = {0, 1, 3, 5, 7, 9, 11, 13, 15};
+    unsigned short i = 0;
+    for(TokenView t = tz.get(); t; t = tz.get(), ++i) {
+        ASSERT_EQ(t.offset, expected[i]);
+    }
+    ASSERT_EQ(i, 9);
+}
+TEST(BUFFER_TOKENIZER, positions) {
+    std::string input = "'ID' =\n  \\ x.\n x;";
+    BufferTokenizer<> tz{input};
+    tz.set_position(3, 5);
+    std::pair<std::uint32_t, std::uint32_t> expected[] = {
+        {3, 5}, {3, 6}, {3, 8}, {3, 10}, {4, 3}, {4, 5}, {4, 6}, {5, 2},
+        {5, 3}};
+    unsigned short i = 0;
+    for(TokenView t = tz.get(); t; t = tz.get(), ++i) {
+        ASSERT_EQ(t.line, expected[i].first) << t.str;
+        ASSERT_EQ(t.column, expected[i].second) << t.str;
+    }
+    ASSERT_EQ(i, 9);
+}
+TEST(BUFFER_TOKENIZER, reserved) {
+    bool called = false, word_called = false;
+    std::string input = "?xyz exit";
+    BufferTokenizer<> tz{input};
+    tz.register_symbol("?", [&called](){called = true;});
+    tz.register_symbol("exit", [&word_called](){word_called = true;});
+    ASSERT_FALSE(tz.get());
+    ASSERT_TRUE(called);
+    ASSERT_EQ(tz.get().str, "xyz");
+    tz.unregister_symbol("exit");
+    ASSERT_EQ(tz.get().str, "exit");
+    ASSERT_FALSE(word_called);
+}
+TEST(BUFFER_TOKENIZER, errors) {
+    std::string inputs[] = {"/ x . x y", "xy?", "x1", "12ab"};
+    for(const auto& input: inputs) {
+        BufferTokenizer<> tz{input};
+        ASSERT_THROW(while(tz.get()), SyntaxException);
+    }
+    BufferTokenizer<> tz{""};
+    ASSERT_THROW(tz.register_symbol("?hallo", []() {}),
+                 InvalidReservedSymbol);
+}
+TEST(BUFFER_TOKENIZER, long_runs) {
+    // runs longer than one vector, ending at every offset within one
+    for(std::size_t n: {1, 15, 16, 17, 31, 32, 33, 100}) {
+        std::string name(n, 'a');
+        name[n - 1] = 'Z';
+        std::string spaces(n, ' ');
+        spaces[n / 2] = '\n';
+        buffer_test(spaces + "\\ " + name + " ." + spaces + name + " " +
+                    std::string(n, '7') + "#" + spaces + "\n" + name);
+    }
+}
+TEST(BUFFER_TOKENIZER, overwritten_whitespace) {
+    // '\n' is not whitespace if it is the separator
+    enum class MySymbol {
+        lambda = '\\',
+        body_start = '.',
+        bracket_open = '(',
+        bracket_close = ')',
+        separator = '\n',
+        comment = '#',
+        assignment = '=',
+        conversion_end = '>',
+        name_definition = '\''
+    };
+    std::string input = "x                 \n                 y";
+    BufferTokenizer<MySymbol> tz{input};
+    ASSERT_EQ(tz.get().tok, TokenType::identifier);
+    ASSERT_EQ(tz.get().tok, TokenType::separator);
+    ASSERT_EQ(tz.get().tok, TokenType::identifier);
+    ASSERT_FALSE(tz.get());
+}
+template <CharRun run>
+void scan_test() {
+    // the vector scan agrees with the scalar one on every byte value
+    std::string input;
+    for(int i = 0; i < 4096; ++i)
+        input += static_cast<char>((i * 7919) % 256);
+    for(int c = 0; c < 256; ++c) input += std::string(40, c);
+    const char* end = input.data() + input.size();
+    for(const char* p = input.data(); p != end; ++p)
+        ASSERT_EQ(CharScan::skip<run>(p, end),
+                  CharScan::skip_scalar<run>(p, end));
+}
+TEST(CHAR_SCAN, agrees_with_scalar) {
+    scan_test<CharRun::space>();
+    scan_test<CharRun::letter>();
+    scan_test<CharRun::digit>();
+    ASSERT_TRUE(CharScan::is<CharRun::space>('\v'));
+    ASSERT_FALSE(CharScan::is<CharRun::letter>('['));
+    ASSERT_FALSE(CharScan::is<CharRun::letter>(0xe1));
+}